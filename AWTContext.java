@@ -27,20 +27,116 @@ package net.runelite.rlawt;
 import java.awt.Component;
 import java.awt.Insets;
 import java.awt.Window;
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.lang.annotation.Native;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.file.Files;
 import java.nio.file.Path;
+import java.nio.file.Paths;
 import java.nio.file.StandardCopyOption;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashSet;
+import java.util.Set;
+import java.util.concurrent.CompletableFuture;
 
 public final class AWTContext
 {
+	public static final int SCREENSHOT_PNG = 0;
+	public static final int SCREENSHOT_QOI = 1;
+
+	public static final int DEBUG_SEVERITY_NOTIFICATION = 0;
+	public static final int DEBUG_SEVERITY_LOW = 1;
+	public static final int DEBUG_SEVERITY_MEDIUM = 2;
+	public static final int DEBUG_SEVERITY_HIGH = 3;
+
+	/**
+	 * What the renderer behind a context is and what it can do. Sizes are in kilobytes, and anything
+	 * the driver does not report is -1.
+	 */
+	public static final class Capabilities
+	{
+		public final String vendor;
+		public final String renderer;
+		public final String version;
+		public final String shadingLanguageVersion;
+		public final Set<String> extensions;
+
+		/**
+		 * PCI vendor and device ids, from GLX_MESA_query_renderer.
+		 */
+		public final int vendorId;
+		public final int deviceId;
+
+		/**
+		 * Whether the renderer runs on the CPU, such as llvmpipe.
+		 */
+		public final boolean software;
+		/**
+		 * 1 if the renderer shares system memory, 0 if it has its own, or -1 if unknown.
+		 */
+		public final int unifiedMemory;
+		public final long videoMemory;
+		/**
+		 * Video memory plus whatever system memory the driver may page to, from GL_NVX_gpu_memory_info.
+		 */
+		public final long totalMemory;
+
+		public final int maxTextureSize;
+		public final int max3DTextureSize;
+		public final int maxArrayTextureLayers;
+		public final int maxRenderbufferSize;
+		public final int maxSamples;
+		public final int maxCombinedTextureImageUnits;
+		public final int maxUniformBlockSize;
+		public final int maxVertexAttribs;
+		public final int maxColorAttachments;
+		public final int maxAnisotropy;
+
+		private Capabilities(String[] strings, long[] limits)
+		{
+			vendor = strings[0];
+			renderer = strings[1];
+			version = strings[2];
+			shadingLanguageVersion = strings[3];
+			extensions = strings[4].isEmpty()
+				? Collections.emptySet()
+				: Collections.unmodifiableSet(new HashSet<>(Arrays.asList(strings[4].split(" "))));
+
+			vendorId = (int) limits[0];
+			deviceId = (int) limits[1];
+			// limits[2] is whether the renderer is accelerated, which software already accounts for
+			unifiedMemory = (int) limits[3];
+			videoMemory = limits[4];
+			totalMemory = limits[5];
+			software = limits[6] != 0;
+			maxTextureSize = (int) limits[7];
+			max3DTextureSize = (int) limits[8];
+			maxArrayTextureLayers = (int) limits[9];
+			maxRenderbufferSize = (int) limits[10];
+			maxSamples = (int) limits[11];
+			maxCombinedTextureImageUnits = (int) limits[12];
+			maxUniformBlockSize = (int) limits[13];
+			maxVertexAttribs = (int) limits[14];
+			maxColorAttachments = (int) limits[15];
+			maxAnisotropy = (int) limits[16];
+		}
+	}
+
 	private static boolean nativesLoaded = false;
 
 	@Native
 	private long instance;
 
+	private int bufferMode;
+
+	private Capabilities capabilities;
+
 	public synchronized static void loadNatives()
 	{
 		if (nativesLoaded)
@@ -79,6 +175,7 @@ public final class AWTContext
 		}
 
 		String path = os + "-" + arch + "/" + name;
+		byte[] lib;
 		try (InputStream is = AWTContext.class.getResourceAsStream(path))
 		{
 			if (is == null)
@@ -86,9 +183,41 @@ public final class AWTContext
 				throw new RuntimeException("rlawt does not exist at " + path);
 			}
 
+			ByteArrayOutputStream bos = new ByteArrayOutputStream();
+			byte[] buf = new byte[16384];
+			for (int read; (read = is.read(buf)) != -1; )
+			{
+				bos.write(buf, 0, read);
+			}
+			lib = bos.toByteArray();
+		}
+		catch (IOException e)
+		{
+			throw new RuntimeException(e);
+		}
+
+		Path cached = null;
+		try
+		{
+			cached = extractToCache(os, name, lib);
+		}
+		catch (IOException | SecurityException e)
+		{
+			// fall back to a throwaway copy below
+		}
+
+		if (cached != null)
+		{
+			System.load(cached.toAbsolutePath().toString());
+			nativesLoaded = true;
+			return;
+		}
+
+		try
+		{
 			Path temp = Files.createTempFile("", name);
 			temp.toFile().deleteOnExit();
-			Files.copy(is, temp, StandardCopyOption.REPLACE_EXISTING);
+			Files.write(temp, lib);
 			System.load(temp.toAbsolutePath().toString());
 			nativesLoaded = true;
 		}
@@ -98,6 +227,110 @@ public final class AWTContext
 		}
 	}
 
+	private static Path cacheDirectory(String os)
+	{
+		String home = System.getProperty("user.home");
+		if (os.equals("windows"))
+		{
+			String localAppData = System.getenv("LOCALAPPDATA");
+			return localAppData != null ? Paths.get(localAppData, "rlawt") : null;
+		}
+		else if (os.equals("macos"))
+		{
+			return home != null ? Paths.get(home, "Library", "Caches", "rlawt") : null;
+		}
+
+		String xdgCache = System.getenv("XDG_CACHE_HOME");
+		if (xdgCache != null && !xdgCache.isEmpty())
+		{
+			return Paths.get(xdgCache, "rlawt");
+		}
+		return home != null ? Paths.get(home, ".cache", "rlawt") : null;
+	}
+
+	/**
+	 * Whether the file holds exactly the bundled library. Its name says what it should hold, but anything
+	 * running as this user could have changed or truncated it since, so it is compared byte for byte.
+	 */
+	private static boolean matches(Path file, byte[] lib) throws IOException
+	{
+		return Files.isRegularFile(file)
+			&& Files.size(file) == lib.length
+			&& Arrays.equals(Files.readAllBytes(file), lib);
+	}
+
+	/**
+	 * Extracts the library into a per-user cache directory named after its hash,
+	 * so every launch of the same build reuses one file without copying it again.
+	 * The library is written to a temporary file next to its final name and then
+	 * renamed into place, so concurrent launches never load a partial file. A cached file which no longer
+	 * matches the library is replaced the same way.
+	 */
+	private static Path extractToCache(String os, String name, byte[] lib) throws IOException
+	{
+		Path dir = cacheDirectory(os);
+		if (dir == null)
+		{
+			return null;
+		}
+
+		String hash;
+		try
+		{
+			StringBuilder sb = new StringBuilder();
+			for (byte b : MessageDigest.getInstance("SHA-256").digest(lib))
+			{
+				sb.append(String.format("%02x", b & 0xFF));
+			}
+			hash = sb.toString();
+		}
+		catch (NoSuchAlgorithmException e)
+		{
+			return null;
+		}
+
+		Path target = dir.resolve(hash).resolve(name);
+		if (matches(target, lib))
+		{
+			return target;
+		}
+
+		Files.createDirectories(target.getParent());
+		Path temp = Files.createTempFile(target.getParent(), name, ".tmp");
+		try
+		{
+			Files.write(temp, lib);
+			try
+			{
+				Files.move(temp, target, StandardCopyOption.ATOMIC_MOVE);
+			}
+			catch (IOException e)
+			{
+				// another launch may have won the race, and windows will not replace a loaded dll
+				if (!matches(target, lib))
+				{
+					throw e;
+				}
+			}
+		}
+		finally
+		{
+			Files.deleteIfExists(temp);
+		}
+		return target;
+	}
+
+	/**
+	 * Sets how many destroyed contexts are kept alive, along with their display connection, so that
+	 * a new {@link AWTContext} with the same pixel format can adopt one instead of creating a new
+	 * context. Adopted contexts keep all of their GL objects and state. Defaults to 0, which disables
+	 * pooling. Destroying a context makes it current on the destroying thread, so the objects rlawt
+	 * itself created can be deleted before it is pooled, then restores whatever that thread had current.
+	 * A context which is still current on another thread is destroyed instead of pooled. Only supported
+	 * on Linux.
+	 */
+	public static native void setContextPoolSize(int size);
+
 	private static native long create0(Component component);
 
 	public AWTContext(Component component)
@@ -137,20 +370,106 @@ public final class AWTContext
 
 	public native void configureMultisamples(int samples);
 
+	/**
+	 * Makes the context created by {@link #createGLContext()} share textures, buffers and other shareable
+	 * objects with {@code share}, which must already be created and must not be destroyed before
+	 * {@link #createGLContext()} is called. On Linux both contexts also share a display connection, so the
+	 * canvases must be on the same display and screen.
+	 */
+	public native void configureSharedContext(AWTContext share);
+
+	/**
+	 * Creates the context with EGL instead of GLX and renders into a ring of {@code images} textures which
+	 * are exported as DMA-BUFs, so other APIs and processes can import frames without copying them. The app
+	 * must render into {@link #getFramebuffer(boolean)} and fetch it again after every
+	 * {@link #swapBuffers()}, which shows the image on the canvas and moves on to the next one. 0 disables
+	 * export. Shared contexts, multisampling and {@link #reconfigurePixelFormat} are not supported with it.
+	 * Only supported on Linux, with drivers which implement EGL_MESA_image_dma_buf_export.
+	 */
+	public native void configureDmaBufExport(int images);
+
+	/**
+	 * Creates the context with the debug flag, which {@link #startDebugMessages} needs. Debug contexts
+	 * are never pooled. Only supported on Linux.
+	 */
+	public native void configureDebugContext(boolean debug);
+
+	/**
+	 * Changes the pixel format of a created context. The replacement context is created in the same
+	 * share group and the old one is destroyed, so textures, buffers, shaders and other shareable objects
+	 * survive, but container objects such as vertex arrays and framebuffers must be recreated. The
+	 * context must be current, and {@link #getGLContext()} changes. Debug output started with
+	 * {@link #startDebugMessages} carries over to the new context. Only supported on Linux.
+	 * <p>
+	 * Only formats with the canvas's visual can be chosen. DRI drivers also allocate a window's depth,
+	 * stencil and multisample buffers when it is first bound and keep them, so changing those may not
+	 * take effect on the canvas itself; render into a framebuffer object when they have to change.
+	 */
+	public native void reconfigurePixelFormat(int alpha, int depth, int stencil, int samples);
+
+	/**
+	 * Describes every pixel format which satisfies the configured one, best first, with the score the
+	 * selector gave it. The format in use is prefixed with {@code *}. Formats the driver flags as slow or
+	 * non-conformant, and those with unrequested samples, accumulation or auxiliary buffers, rank lower.
+	 * Only supported on Linux.
+	 */
+	public native String[] getFBConfigCandidates();
+
+	/**
+	 * Starts collecting KHR_debug messages of at least {@code minSeverity}, one of the
+	 * {@code DEBUG_SEVERITY_} constants, into a native ring of {@code capacity} messages, a power of two
+	 * which cannot change once set. Messages never cross into Java on their own; they are dropped when the
+	 * ring is full. Must be called again after {@link #reconfigurePixelFormat}. The context must have been
+	 * created with {@link #configureDebugContext} and must be current. Only supported on Linux.
+	 */
+	public native void startDebugMessages(int capacity, int minSeverity);
+
+	/**
+	 * Stops collecting debug messages. Messages already in the ring can still be drained. This context must
+	 * be current.
+	 */
+	public native void stopDebugMessages();
+
+	/**
+	 * Drops messages with any of these ids before they reach the ring, replacing the previous list. At most
+	 * 64 ids.
+	 */
+	public native void setIgnoredDebugMessages(int[] ids);
+
+	/**
+	 * Moves as many messages as fit from the ring into {@code buffer}, a direct buffer, starting at its
+	 * beginning regardless of its position, and returns how many were written. Each message is five native
+	 * order ints, the GL source, type, id and severity and the message length, followed by that many
+	 * UTF-8 bytes padded to a multiple of four. Messages over 240 bytes are truncated. Only one thread may
+	 * drain at a time.
+	 */
+	public native int drainDebugMessages(ByteBuffer buffer);
+
+	/**
+	 * Gets counters for debug messages: received, dropped because the ring was full, and ignored by id.
+	 */
+	public native long[] getDebugStats();
+
 	/**
 	 * Gets the name of the active front or back framebuffer object.
 	 */
 	public native int getFramebuffer(boolean front);
 
 	/**
-	 * Gets the framebuffer target name associated with {@link #getFramebuffer(boolean)}
+	 * Gets the framebuffer target name associated with {@link #getFramebuffer(boolean)}.
+	 * Whether the front buffer is a framebuffer object cannot change once the context
+	 * is created, so this only crosses into native code on the first call.
 	 */
 	public int getBufferMode()
 	{
 		final int GL_FRONT = 0x404;
 		final int GL_COLOR_ATTACHMENT0 = 0x8CE0;
 
-		return getFramebuffer(true) == 0 ? GL_FRONT : GL_COLOR_ATTACHMENT0;
+		if (bufferMode == 0)
+		{
+			bufferMode = getFramebuffer(true) == 0 ? GL_FRONT : GL_COLOR_ATTACHMENT0;
+		}
+		return bufferMode;
 	}
 
 	/**
@@ -159,18 +478,365 @@ public final class AWTContext
 	 */
 	public native void createGLContext();
 
+	/**
+	 * Runs {@link #createGLContext()} on a new thread, so opening the display connection, choosing a
+	 * pixel format and creating the context can overlap other startup work. On Linux that thread also
+	 * warms up the driver by querying {@link #getCapabilities()} and {@link #getFreeVideoMemory()},
+	 * whose first calls can stall while the driver loads, and the capabilities stay cached. The context
+	 * is detached from that thread before the future completes, ready for {@link #makeCurrent()} on the
+	 * render thread. No other method may be called until the future has completed.
+	 */
+	public CompletableFuture<Void> createGLContextAsync()
+	{
+		CompletableFuture<Void> future = new CompletableFuture<>();
+		Thread thread = new Thread(() ->
+		{
+			try
+			{
+				createGLContext();
+				if (System.getProperty("os.name", "no-os").toLowerCase().contains("nux"))
+				{
+					getCapabilities();
+					getFreeVideoMemory();
+				}
+				detachCurrent();
+				future.complete(null);
+			}
+			catch (Throwable t)
+			{
+				future.completeExceptionally(t);
+			}
+		}, "rlawt-create-context");
+		thread.setDaemon(true);
+		thread.start();
+		return future;
+	}
+
+	/**
+	 * Sets the number of vblanks to wait for between swaps, returning the interval which was applied.
+	 * A negative interval requests adaptive sync, where late frames are presented immediately instead
+	 * of waiting for the next vblank. Drivers without late swap tearing get an emulation which switches
+	 * between intervals 1 and 0 as frames miss or make vblank.
+	 */
 	public native int setSwapInterval(int interval);
 
+	/**
+	 * Returns true if {@link #createGLContext()} adopted a pooled context, in which case the GL objects
+	 * created by its previous owner still exist.
+	 */
+	public native boolean isContextReused();
+
+	/**
+	 * Returns the adaptive sync statistics: swapped frames, missed vblanks, switches to immediate
+	 * presentation, switches back to vsync, the current swap interval and the refresh period in
+	 * nanoseconds, or 0 if it is unknown.
+	 */
+	public native long[] getSwapStats();
+
+	/**
+	 * Limits {@link #swapBuffers()} to {@code fps} frames per second, or removes the limit if it is not
+	 * positive. This works without any swap control extension, and sleeps against absolute deadlines
+	 * before spinning for the last fraction of a millisecond. This may be called from any thread, and
+	 * takes effect on the next swap.
+	 */
+	public native void setFrameLimit(int fps);
+
+	/**
+	 * Returns the frame limiter's statistics: the number of paced frames, the mean and max wake up error
+	 * in nanoseconds, and the number of frames which arrived after their deadline.
+	 */
+	public native long[] getFrameLimiterStats();
+
+	/**
+	 * Makes this context current on the calling thread. On Linux this returns straight away, without
+	 * taking the AWT lock, if the context is already current and bound to the canvas on this thread.
+	 */
 	public native void makeCurrent();
 
 	public native void detachCurrent();
 
+	/**
+	 * Whether this context is current on the calling thread. Does not take the AWT lock.
+	 */
+	public native boolean isCurrent();
+
+	/**
+	 * Runs {@code task} with this context current. If the context was not already current on this thread
+	 * it is made current first and detached afterwards, leaving no context current.
+	 */
+	public void withCurrent(Runnable task)
+	{
+		boolean wasCurrent = isCurrent();
+		if (!wasCurrent)
+		{
+			makeCurrent();
+		}
+		try
+		{
+			task.run();
+		}
+		finally
+		{
+			if (!wasCurrent)
+			{
+				detachCurrent();
+			}
+		}
+	}
+
+	/**
+	 * Gets counters for {@link #makeCurrent()}: calls skipped because the context was already current,
+	 * and calls which had to bind it. Only supported on Linux.
+	 */
+	public native long[] getMakeCurrentStats();
+
+	/**
+	 * Asks the compositor to stop compositing the window containing the canvas, by setting
+	 * {@code _NET_WM_BYPASS_COMPOSITOR} on its top level window, which most compositors honour while the
+	 * window is fullscreen. While enabled {@link #swapBuffers()} also keeps at most one frame in flight,
+	 * trading some throughput for latency. Only supported on Linux.
+	 */
+	public native void setBypassCompositor(boolean bypass);
+
+	/**
+	 * Enables {@link #setBypassCompositor(boolean)} along with adaptive sync, for the lowest latency
+	 * presentation available in fullscreen. Returns the swap interval which was applied.
+	 */
+	public int enableLowLatencyPresentation()
+	{
+		setBypassCompositor(true);
+		return setSwapInterval(-1);
+	}
+
+	/**
+	 * Returns the compositor bypass status: whether bypass was requested, whether a compositor is running,
+	 * whether the top level window is still redirected (1), unredirected (0) or unknown because it isn't
+	 * mapped (-1), and how many swaps waited on the previous frame and for how many nanoseconds in total.
+	 * The window is presented directly, and can be flipped to the screen, while nothing composites it.
+	 */
+	public native long[] getBypassStatus();
+
+	/**
+	 * Whether the canvas is currently presented without going through a compositor.
+	 */
+	public boolean isCompositorBypassed()
+	{
+		long[] status = getBypassStatus();
+		return status[1] == 0 || status[2] == 0;
+	}
+
 	/**
 	 * Presents the framebuffer to the user. After calling this you MUST bind
 	 * the current active framebuffer (see {@link #getFramebuffer(boolean)}) before drawing anything else
 	 */
 	public native void swapBuffers();
 
+	/**
+	 * Returns false while the canvas is unmapped, minimized or fully obscured, in which case there is
+	 * no point rendering to it. Compositing window managers report every mapped window as unobscured,
+	 * so there this only tracks the window being mapped.
+	 */
+	public native boolean shouldRender();
+
+	/**
+	 * Blocks until {@link #shouldRender()} would return true, or until {@code timeoutMillis} has elapsed.
+	 * Returns the final value of {@link #shouldRender()}.
+	 */
+	public native boolean waitForRender(long timeoutMillis);
+
+	/**
+	 * Opens (creating it if needed) an on-disk cache of linked program binaries. Entries are tied
+	 * to the GL_VENDOR, GL_RENDERER and GL_VERSION of this context and are discarded automatically
+	 * when the driver changes. The file may be shared by several processes. This context must be current.
+	 */
+	public native void openProgramCache(String path);
+
+	/**
+	 * Links {@code program} from the binary cached for {@code source}, which should identify all of the
+	 * program's shader sources. Returns false if there was no usable binary, in which case the program
+	 * must be compiled and linked normally and then passed to {@link #storeProgramBinary(int, String)}.
+	 */
+	public native boolean loadProgramBinary(int program, String source);
+
+	/**
+	 * Stores the binary of a linked program in the program cache. The program should have been linked
+	 * with {@code GL_PROGRAM_BINARY_RETRIEVABLE_HINT} set.
+	 */
+	public native void storeProgramBinary(int program, String source);
+
+	/**
+	 * Allows the driver to compile and link shaders on up to {@code count} background threads, or as many
+	 * as it likes if negative. Programs can then be polled with {@code GL_COMPLETION_STATUS_KHR} instead of
+	 * blocking on their link status. Returns false if the driver does not support parallel compilation.
+	 */
+	public native boolean setShaderCompilerThreads(int count);
+
+	/**
+	 * Makes {@link #swapBuffers()} also present each frame into {@code mirror}'s canvas, with a blit from a
+	 * texture shared by both contexts instead of a second render. The mirror must have been created with
+	 * {@link #configureSharedContext(AWTContext)} in this context's share group and is then driven entirely
+	 * by this context, so it should not be used for rendering itself. Only supported on Linux.
+	 */
+	public native void addMirror(AWTContext mirror);
+
+	public native void removeMirror(AWTContext mirror);
+
+	/**
+	 * Sets the factor by which frames are downscaled before being presented into mirrors. Ignored for
+	 * multisampled contexts, which can only be resolved at full size.
+	 */
+	public native void setMirrorScale(int divisor);
+
+	/**
+	 * Creates a {@code width} x {@code height} overlay which {@link #swapBuffers()} blends over each frame,
+	 * anchored to the top left of the canvas. Pixels are premultiplied ARGB ints, as in
+	 * {@code TYPE_INT_ARGB_PRE}, stored top down in the returned buffer, which starts fully transparent.
+	 * Only the regions passed to {@link #markOverlayDirty(int, int, int, int)} are uploaded. Once the
+	 * overlay is replaced or destroyed the buffer is no longer shown, and it is freed like any other buffer
+	 * when unreachable. It must only be written on the thread which swaps buffers. This context must be
+	 * current. Only supported on Linux.
+	 */
+	public ByteBuffer createOverlay(int width, int height)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			throw new IllegalArgumentException("invalid overlay size");
+		}
+
+		ByteBuffer buffer = ByteBuffer.allocateDirect(Math.multiplyExact(Math.multiplyExact(width, height), 4))
+			.order(ByteOrder.nativeOrder());
+		createOverlay0(buffer, width, height);
+		return buffer;
+	}
+
+	private native void createOverlay0(ByteBuffer buffer, int width, int height);
+
+	/**
+	 * Marks a region of the overlay as changed, so it is uploaded by the next {@link #swapBuffers()}.
+	 */
+	public native void markOverlayDirty(int x, int y, int width, int height);
+
+	public native void destroyOverlay();
+
+	/**
+	 * Makes {@link #swapBuffers()} pass every frame, including the overlay, through a {@code size}^3 color
+	 * lookup table, in the same pass which composites the overlay. {@code data} must be a direct buffer of
+	 * RGB byte triplets with red varying fastest and blue slowest. The table is copied, so the buffer may be
+	 * reused. Passing null removes the table. This context must be current. Only supported on Linux.
+	 */
+	public native void setColorLut(int size, ByteBuffer data);
+
+	/**
+	 * Makes {@link #swapBuffers()} keep the last {@code frames} presented frames on the gpu, downscaled by
+	 * {@code divisor} and taking only every {@code interval}th frame, with one blit per recorded frame and no
+	 * readback. The ring uses about {@code frames * (width / divisor) * (height / divisor) * 4} bytes of video
+	 * memory. Reconfiguring discards what was recorded, and a non-positive {@code frames} removes the ring.
+	 * This context must be current. Only supported on Linux.
+	 */
+	public native void setReplayBuffer(int frames, int divisor, int interval);
+
+	/**
+	 * Starts writing the recorded frames, oldest first, to {@code path} as a stream of PAM images, returning
+	 * the number of frames. Frames are read back asynchronously over the following {@link #swapBuffers()}
+	 * calls and written on a background thread, and recording is paused until the dump is complete.
+	 */
+	public native int dumpReplay(String path);
+
+	/**
+	 * Returns the number of frames of the current dump which are yet to be written, or 0 once it is complete.
+	 * Throws if the completed dump could not be written. Must be called from the thread which swaps buffers.
+	 */
+	public native int pollReplayDump();
+
+	/**
+	 * Starts streaming every frame presented by {@link #swapBuffers()} to {@code path}, which may be a file or
+	 * a fifo read by an encoder such as ffmpeg, as a {@code fps} frames per second Y4M video of {@code width} x
+	 * {@code height}, or the current canvas size if either is not positive. Frames are scaled to the capture size
+	 * and read back asynchronously, then converted to I420 and written on a background thread. Frames are dropped
+	 * instead of stalling the render thread when the encoder falls behind. This context must be current. Only
+	 * supported on Linux.
+	 */
+	public native void startCapture(String path, int width, int height, int fps);
+
+	/**
+	 * Writes the frames which are still in flight and closes the capture output, throwing if any frame
+	 * could not be written. This context must be current for in flight frames to be written.
+	 */
+	public native void stopCapture();
+
+	/**
+	 * Returns the capture statistics: frames read back, frames dropped and frames written.
+	 */
+	public native long[] getCaptureStats();
+
+	/**
+	 * Starts an asynchronous read back of the front or back buffer, which is then flipped and encoded as
+	 * {@link #SCREENSHOT_PNG} or {@link #SCREENSHOT_QOI} on background threads, with pngs deflated in parallel
+	 * strips. The image is written to {@code path} if it is not null. Only one screenshot may be pending at a
+	 * time. This context must be current. Only supported on Linux.
+	 */
+	public native void requestScreenshot(boolean front, int format, String path);
+
+	/**
+	 * Returns null while the pending screenshot is being encoded, then its encoded bytes, or an empty array
+	 * if it was written to a file. Throws if it could not be encoded or written. This context must be current.
+	 */
+	public native byte[] pollScreenshot();
+
+	/**
+	 * Publishes every frame presented by {@link #swapBuffers()} into a ring of {@code slots} frames in the POSIX
+	 * shared memory object {@code name}, for other local processes to map. Frames are read back asynchronously
+	 * and scaled down to fit {@code maxWidth} x {@code maxHeight}, or the current canvas size if either is not
+	 * positive. Each slot is guarded by a sequence lock and a futex word is bumped for every frame, so consumers
+	 * can read frames in place and never hold up rendering; the layout is described in rlawt_frameserver.c. Throws
+	 * if {@code name} is taken, unless it holds a ring which was closed or whose producer has exited. This
+	 * context must be current. Only supported on Linux.
+	 */
+	public native void startFrameServer(String name, int maxWidth, int maxHeight, int slots);
+
+	/**
+	 * Marks the ring closed, wakes any waiting consumers and unlinks it.
+	 */
+	public native void stopFrameServer();
+
+	/**
+	 * Describes the exported DMA-BUF images as {@code generation, width, height, fourcc} followed by
+	 * {@code fd, stride, offset, modifier} for each image. Rows are stored bottom up. The images are
+	 * reallocated with new file descriptors when the canvas is resized, which increments the generation.
+	 * The file descriptors belong to this process and are closed when the images are reallocated.
+	 */
+	public native long[] getDmaBufImages();
+
+	/**
+	 * Gets the index of the newest exported image which has finished rendering since the last call, or -1.
+	 * An image is overwritten {@code images - 1} frames after it is presented. This context must be current.
+	 */
+	public native int pollDmaBufFrame();
+
+	/**
+	 * Describes the renderer, querying it on the first call. This context must be current. Only
+	 * supported on Linux.
+	 */
+	public Capabilities getCapabilities()
+	{
+		if (capabilities == null)
+		{
+			capabilities = new Capabilities(getRendererStrings0(), getRendererLimits0());
+		}
+		return capabilities;
+	}
+
+	private native String[] getRendererStrings0();
+
+	private native long[] getRendererLimits0();
+
+	/**
+	 * Gets the video memory currently free in kilobytes, or -1 if the driver does not implement
+	 * GL_NVX_gpu_memory_info or GL_ATI_meminfo. Cheap enough to poll every frame. This context must be
+	 * current. Only supported on Linux.
+	 */
+	public native long getFreeVideoMemory();
+
 	public native long getGLContext();
 
 	public native long getCGLShareGroup();
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+package net.runelite.rlawt.bench;
+
+import java.util.concurrent.TimeUnit;
+import net.runelite.rlawt.AWTContext;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+/**
+ * Per-call cost of the {@link AWTContext} entry points from the thread the context is current on.
+ * Pairs of benchmarks compare a JNI path against a cheaper binding for the same answer: the cached
+ * {@link AWTContext#getBufferMode()} against deriving it from {@code getFramebuffer}, and the lock-free
+ * early return of {@link AWTContext#makeCurrent()} against a full rebind under the AWT lock.
+ *
+ * <p>Needs an X server, such as Xvfb, and the native library from the CMake build:
+ * <pre>
+ * mvn -f bench/pom.xml package
+ * xvfb-run -s "-screen 0 1280x720x24" java -Drunelite.rlawtpath=$PWD/build/librlawt.so -jar bench/target/benchmarks.jar
+ * </pre>
+ */
+@State(Scope.Thread)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class BoundaryBenchmark
+{
+	private static final int GL_FRONT = 0x404;
+	private static final int GL_COLOR_ATTACHMENT0 = 0x8CE0;
+
+	private CanvasFixture fixture;
+	private AWTContext context;
+
+	@Setup(Level.Trial)
+	public void setup() throws Exception
+	{
+		fixture = new CanvasFixture();
+		context = fixture.context;
+		context.makeCurrent();
+	}
+
+	@TearDown(Level.Trial)
+	public void tearDown() throws Exception
+	{
+		context.detachCurrent();
+		fixture.close();
+	}
+
+	@Benchmark
+	public void makeCurrentBound()
+	{
+		context.makeCurrent();
+	}
+
+	@Benchmark
+	public void makeCurrentRebind()
+	{
+		context.detachCurrent();
+		context.makeCurrent();
+	}
+
+	@Benchmark
+	public boolean isCurrent()
+	{
+		return context.isCurrent();
+	}
+
+	@Benchmark
+	public int getFramebuffer()
+	{
+		return context.getFramebuffer(false);
+	}
+
+	@Benchmark
+	public int getBufferMode()
+	{
+		return context.getBufferMode();
+	}
+
+	/**
+	 * What {@link AWTContext#getBufferMode()} cost before it was cached.
+	 */
+	@Benchmark
+	public int getBufferModeNative()
+	{
+		return context.getFramebuffer(true) == 0 ? GL_FRONT : GL_COLOR_ATTACHMENT0;
+	}
+
+	@Benchmark
+	public boolean shouldRender()
+	{
+		return context.shouldRender();
+	}
+
+	@Benchmark
+	public void swapBuffers()
+	{
+		context.swapBuffers();
+	}
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+package net.runelite.rlawt.bench;
+
+import java.awt.Canvas;
+import java.awt.EventQueue;
+import java.awt.Frame;
+import net.runelite.rlawt.AWTContext;
+
+/**
+ * A visible canvas with a created context, detached so whichever thread benchmarks it can bind it.
+ * Vsync is disabled, so {@code swapBuffers} measures the binding rather than the refresh rate.
+ */
+final class CanvasFixture
+{
+	final Frame frame;
+	final AWTContext context;
+
+	CanvasFixture() throws Exception
+	{
+		AWTContext.loadNatives();
+
+		Canvas canvas = new Canvas();
+		canvas.setSize(640, 480);
+		frame = new Frame("rlawt benchmark");
+		frame.add(canvas);
+		EventQueue.invokeAndWait(() ->
+		{
+			frame.pack();
+			frame.setVisible(true);
+		});
+
+		context = new AWTContext(canvas);
+		context.configurePixelFormat(0, 0, 0);
+		context.createGLContext();
+		context.setSwapInterval(0);
+		context.detachCurrent();
+	}
+
+	void close() throws Exception
+	{
+		context.destroy();
+		EventQueue.invokeAndWait(frame::dispose);
+	}
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+package net.runelite.rlawt.bench;
+
+import java.util.concurrent.TimeUnit;
+import net.runelite.rlawt.AWTContext;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Group;
+import org.openjdk.jmh.annotations.GroupThreads;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+/**
+ * The same entry points as {@link BoundaryBenchmark} with several threads calling into one context.
+ * {@code awtLock} renders on one thread while others poll {@link AWTContext#shouldRender()}, which
+ * contend for the AWT lock the way a game loop and the event thread do. {@code jniQuery} and
+ * {@code cachedQuery} show how a lock-free native query and its cached Java counterpart scale.
+ */
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 5, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class ContendedBenchmark
+{
+	private static final int GL_FRONT = 0x404;
+	private static final int GL_COLOR_ATTACHMENT0 = 0x8CE0;
+
+	@State(Scope.Group)
+	public static class Shared
+	{
+		CanvasFixture fixture;
+		AWTContext context;
+
+		@Setup(Level.Trial)
+		public void setup() throws Exception
+		{
+			fixture = new CanvasFixture();
+			context = fixture.context;
+		}
+
+		@TearDown(Level.Trial)
+		public void tearDown() throws Exception
+		{
+			fixture.close();
+		}
+	}
+
+	/**
+	 * Keeps the context current on the one thread which renders.
+	 */
+	@State(Scope.Thread)
+	public static class Renderer
+	{
+		AWTContext context;
+
+		@Setup(Level.Trial)
+		public void setup(Shared shared)
+		{
+			context = shared.context;
+			context.makeCurrent();
+		}
+
+		@TearDown(Level.Trial)
+		public void tearDown()
+		{
+			context.detachCurrent();
+		}
+	}
+
+	@Benchmark
+	@Group("awtLock")
+	@GroupThreads(1)
+	public void swapBuffers(Renderer renderer)
+	{
+		renderer.context.swapBuffers();
+	}
+
+	@Benchmark
+	@Group("awtLock")
+	@GroupThreads(3)
+	public boolean shouldRender(Shared shared)
+	{
+		return shared.context.shouldRender();
+	}
+
+	@Benchmark
+	@Group("jniQuery")
+	@GroupThreads(4)
+	public int getBufferModeNative(Shared shared)
+	{
+		return shared.context.getFramebuffer(true) == 0 ? GL_FRONT : GL_COLOR_ATTACHMENT0;
+	}
+
+	@Benchmark
+	@Group("cachedQuery")
+	@GroupThreads(4)
+	public int getBufferMode(Shared shared)
+	{
+		return shared.context.getBufferMode();
+	}
+}
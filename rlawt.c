@@ -140,15 +140,61 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_configureMultisamples(
 	ctx->multisamples = samples;
 }
 
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_configureSharedContext(JNIEnv *env, jobject self, jobject share) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, false)) {
+		return;
+	}
+
+	if (!share) {
+		ctx->share = NULL;
+		return;
+	}
+
+	AWTContext *shareCtx = rlawtGetContext(env, share);
+	if (!shareCtx || !rlawtContextState(env, shareCtx, true)) {
+		return;
+	}
+
+#ifdef __unix__
+	if (shareCtx->eglContext) {
+		rlawtThrow(env, "shared contexts are not supported with dma-buf export");
+		return;
+	}
+#endif
+
+	ctx->share = shareCtx;
+}
+
 JNIEXPORT jlong JNICALL Java_net_runelite_rlawt_AWTContext_getGLContext(JNIEnv *env, jobject self) {
 	AWTContext *ctx = rlawtGetContext(env, self);
 	if (!ctx || !rlawtContextState(env, ctx, true)) {
 		return 0;
 	}
 
+#ifdef __unix__
+	if (ctx->eglContext) {
+		return (jlong) ctx->eglContext;
+	}
+#endif
 	return (jlong) ctx->context;
 }
 
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_isCurrent(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return false;
+	}
+
+#if defined(__APPLE__)
+	return CGLGetCurrentContext() == ctx->context;
+#elif defined(_WIN32)
+	return wglGetCurrentContext() == ctx->context && wglGetCurrentDC() == ctx->dspi->hdc;
+#else
+	return rlawtIsBound(ctx);
+#endif
+}
+
 JNIEXPORT jlong JNICALL Java_net_runelite_rlawt_AWTContext_getCGLShareGroup(JNIEnv *env, jobject self) {
 	AWTContext *ctx = rlawtGetContext(env, self);
 	if (!ctx || !rlawtContextState(env, ctx, true)) {
@@ -198,6 +244,198 @@ JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_getFramebuffer(JNIEnv
 		return 0;
 	}
 
+#ifdef __unix__
+	if (ctx->dmaBuf) {
+		return rlawtDmaBufFramebuffer(ctx, front);
+	}
+#endif
+	return 0;
+}
+#endif
+
+#ifndef __unix__
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_openProgramCache(JNIEnv *env, jobject self, jstring path) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_loadProgramBinary(JNIEnv *env, jobject self, jint program, jstring source) {
+	rlawtThrow(env, "not supported");
+	return false;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_storeProgramBinary(JNIEnv *env, jobject self, jint program, jstring source) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_setShaderCompilerThreads(JNIEnv *env, jobject self, jint count) {
+	return false;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_reconfigurePixelFormat(JNIEnv *env, jobject self, jint alpha, jint depth, jint stencil, jint samples) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_addMirror(JNIEnv *env, jobject self, jobject mirror) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_removeMirror(JNIEnv *env, jobject self, jobject mirror) {
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setMirrorScale(JNIEnv *env, jobject self, jint divisor) {
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createOverlay0(JNIEnv *env, jobject self, jobject buffer, jint width, jint height) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_markOverlayDirty(JNIEnv *env, jobject self, jint x, jint y, jint width, jint height) {
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_destroyOverlay(JNIEnv *env, jobject self) {
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setColorLut(JNIEnv *env, jobject self, jint size, jobject data) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setReplayBuffer(JNIEnv *env, jobject self, jint frames, jint divisor, jint interval) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_dumpReplay(JNIEnv *env, jobject self, jstring path) {
+	rlawtThrow(env, "not supported");
+	return 0;
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_pollReplayDump(JNIEnv *env, jobject self) {
 	return 0;
 }
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_startCapture(JNIEnv *env, jobject self, jstring path, jint width, jint height, jint fps) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_stopCapture(JNIEnv *env, jobject self) {
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getCaptureStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	return (*env)->NewLongArray(env, 3);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_requestScreenshot(JNIEnv *env, jobject self, jboolean front, jint format, jstring path) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jbyteArray JNICALL Java_net_runelite_rlawt_AWTContext_pollScreenshot(JNIEnv *env, jobject self) {
+	return NULL;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_startFrameServer(JNIEnv *env, jobject self, jstring name, jint maxWidth, jint maxHeight, jint slots) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_stopFrameServer(JNIEnv *env, jobject self) {
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_configureDmaBufExport(JNIEnv *env, jobject self, jint images) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getDmaBufImages(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_pollDmaBufFrame(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return -1;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_net_runelite_rlawt_AWTContext_getFBConfigCandidates(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_net_runelite_rlawt_AWTContext_getRendererStrings0(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getRendererLimits0(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT jlong JNICALL Java_net_runelite_rlawt_AWTContext_getFreeVideoMemory(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return -1;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_configureDebugContext(JNIEnv *env, jobject self, jboolean debug) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_startDebugMessages(JNIEnv *env, jobject self, jint capacity, jint minSeverity) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_stopDebugMessages(JNIEnv *env, jobject self) {
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setIgnoredDebugMessages(JNIEnv *env, jobject self, jintArray ids) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_drainDebugMessages(JNIEnv *env, jobject self, jobject buffer) {
+	return 0;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getDebugStats(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getMakeCurrentStats(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setBypassCompositor(JNIEnv *env, jobject self, jboolean bypass) {
+	rlawtThrow(env, "not supported");
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getBypassStatus(JNIEnv *env, jobject self) {
+	rlawtThrow(env, "not supported");
+	return NULL;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setContextPoolSize(JNIEnv *env, jclass clazz, jint size) {
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_isContextReused(JNIEnv *env, jobject self) {
+	return false;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getSwapStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	return (*env)->NewLongArray(env, 6);
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_shouldRender(JNIEnv *env, jobject self) {
+	return true;
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_waitForRender(JNIEnv *env, jobject self, jlong timeoutMillis) {
+	return true;
+}
 #endif
@@ -27,6 +27,8 @@
 #include <jawt.h>
 #include <jawt_md.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #ifdef __APPLE__
 # define GL_SILENCE_DEPRECATION
@@ -36,8 +38,11 @@
 #endif
 
 #ifdef __unix__
+#	define GL_GLEXT_PROTOTYPES
 #	include <X11/Xlib.h>
 #	include <GL/glx.h>
+#	include <EGL/egl.h>
+#	include <EGL/eglext.h>
 #endif
 
 #ifdef _WIN32
@@ -46,10 +51,21 @@
 #	include <wglext.h>
 #endif
 
+#ifdef __unix__
 typedef struct {
+	int width;
+	int height;
+	int settleWidth;
+	int settleHeight;
+	int64_t shrinkAt;
+} RenderTargetSize;
+#endif
+
+typedef struct AWTContext {
 	JAWT awt;
 	JAWT_DrawingSurface *ds;
 	bool contextCreated;
+	struct AWTContext *share;
 
 #ifdef __APPLE__
 	CALayer *layer;
@@ -68,11 +84,100 @@ typedef struct {
 #ifdef __unix__
 	Display *dpy;
 	Drawable drawable;
+	VisualID visualID;
+	GLXFBConfig fbConfig;
 	GLXContext context;
+	bool contextReused;
+	int dmaBufImages;
+	EGLDisplay eglDisplay;
+	EGLContext eglContext;
+	EGLSurface eglSurface;
+	struct DmaBufRing *dmaBuf;
 	PFNGLXSWAPINTERVALEXTPROC glXSwapIntervalEXT;
 	bool glxSwapControlTear;
 	PFNGLXSWAPINTERVALSGIPROC glXSwapIntervalSGI;
+	PFNGLXGETSYNCVALUESOMLPROC glXGetSyncValuesOML;
 	bool doubleBuffered;
+
+	bool adaptiveSync;
+	int syncInterval;
+	int64_t refreshPeriod;
+	int64_t lastSwap;
+	int64_t lastMsc;
+	int missStreak;
+	int hitStreak;
+	uint64_t swapFrames;
+	uint64_t swapMissed;
+	uint64_t swapToImmediate;
+	uint64_t swapToSync;
+
+	Window ancestors[8];
+	int numAncestors;
+	bool viewable;
+	int visibility;
+	int width;
+	int height;
+
+	bool bypassCompositor;
+	Window bypassWindow;
+	GLsync frameFence;
+	uint64_t frameFenceWaits;
+	int64_t frameFenceWaitTime;
+
+	uint64_t shareGroup;
+	struct AWTContext *mirrors[4];
+	int numMirrors;
+	int mirrorScale;
+	GLuint mirrorTex;
+	GLuint mirrorFbo;
+	int mirrorWidth;
+	int mirrorHeight;
+	RenderTargetSize mirrorTarget;
+	struct AWTContext *mirrorSource;
+	GLuint mirrorReadFbo;
+	bool mirrorReadFboStale;
+
+	uint8_t *overlay;
+	jobject overlayBuffer;
+	int overlayWidth;
+	int overlayHeight;
+	struct {
+		int x, y, width, height;
+	} overlayDirty[8];
+	int numOverlayDirty;
+	GLuint overlayTex;
+	int overlayTexWidth;
+	int overlayTexHeight;
+	GLuint overlayPbo;
+	GLuint overlayProgram;
+	GLint overlayScale;
+	GLuint presentVao;
+
+	int lutSize;
+	GLuint lutTex;
+	GLuint lutProgram;
+	GLint lutHasOverlay;
+	GLint lutHeight;
+	GLint lutScale;
+	GLint lutOffset;
+	GLuint sceneTex;
+	GLuint sceneFbo;
+	RenderTargetSize sceneTarget;
+
+	struct ReplayBuffer *replay;
+	struct Capture *capture;
+	struct Screenshot *screenshot;
+	struct FrameServer *frameServer;
+	int memoryInfo;
+	bool debugContext;
+	struct DebugRing *debug;
+	uint64_t makeCurrentSkipped;
+	uint64_t makeCurrentBound;
+
+	int programCacheFd;
+	uint8_t *programCache;
+	size_t programCacheSize;
+	uint64_t programCacheDriver;
 #endif
 
 #ifdef _WIN32
@@ -81,6 +186,7 @@ typedef struct {
 	HGLRC context;
 	PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT;
 	bool wglSwapControlTear;
+	HANDLE frameTimer;
 #endif
 
 	int alphaDepth;
@@ -88,12 +194,59 @@ typedef struct {
 	int stencilDepth;
 
 	int multisamples;
+
+	int64_t frameInterval;
+	// the remaining limiter state is only touched by the thread calling swapBuffers
+	int64_t frameAppliedInterval;
+	int64_t frameDeadline;
+	uint64_t limiterFrames;
+	int64_t limiterErrorSum;
+	int64_t limiterErrorMax;
+	uint64_t limiterLate;
 } AWTContext;
 
 void rlawtThrow(JNIEnv *env, const char *msg);
 void rlawtUnlockAWT(JNIEnv *env, AWTContext *ctx);
 AWTContext *rlawtGetContext(JNIEnv *env, jobject self);
 bool rlawtContextState(JNIEnv *env, AWTContext *context, bool created);
+void rlawtFrameLimiterWait(AWTContext *ctx);
+int64_t rlawtNanoTime(void);
+
+#ifdef __unix__
+bool rlawtIsCurrent(AWTContext *ctx);
+bool rlawtIsBound(AWTContext *ctx);
+bool rlawtTargetResize(RenderTargetSize *target, int width, int height);
+bool rlawtContextCurrent(JNIEnv *env, AWTContext *ctx);
+bool rlawtHasGLExtension(const char *name);
+bool rlawtHasExtension(const char *extensions, const char *name);
+bool rlawtWriteAll(int fd, const void *data, size_t len);
+void rlawtProgramCacheFree(AWTContext *ctx);
+void rlawtProcessEvents(AWTContext *ctx);
+void rlawtPresentMirrors(AWTContext *ctx);
+void rlawtMirrorsFree(AWTContext *ctx);
+void rlawtPresent(AWTContext *ctx);
+void rlawtPresentFree(JNIEnv *env, AWTContext *ctx);
+void rlawtPresentRecreate(AWTContext *ctx);
+GLuint rlawtResolveBackBuffer(AWTContext *ctx);
+void rlawtReplayCapture(AWTContext *ctx);
+void rlawtReplayFree(AWTContext *ctx);
+void rlawtReplayRecreate(AWTContext *ctx);
+void rlawtCaptureFrame(AWTContext *ctx);
+void rlawtCaptureFree(AWTContext *ctx);
+void rlawtCaptureRecreate(AWTContext *ctx);
+bool rlawtScreenshotStep(AWTContext *ctx);
+void rlawtScreenshotFree(AWTContext *ctx);
+void rlawtFrameServerFrame(AWTContext *ctx);
+void rlawtFrameServerFree(AWTContext *ctx);
+void rlawtFrameServerRecreate(AWTContext *ctx);
+bool rlawtEGLCreate(JNIEnv *env, AWTContext *ctx);
+void rlawtEGLDestroy(AWTContext *ctx);
+GLuint rlawtDmaBufFramebuffer(AWTContext *ctx, bool front);
+void rlawtDebugFree(AWTContext *ctx);
+void rlawtDebugRecreate(AWTContext *ctx);
+bool rlawtDmaBufPresent(AWTContext *ctx);
+void rlawtBgraToI420(const uint8_t *bgra, ptrdiff_t stride, int width, int height, uint8_t *y, uint8_t *u, uint8_t *v);
+#endif
 
 
 void rlawtContextFreePlatform(JNIEnv *env, AWTContext *ctx);
\ No newline at end of file
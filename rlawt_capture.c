@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// frames which can be in flight between the gpu and the encoder at once
+#define CAPTURE_SLOTS 4
+
+enum {
+	SLOT_FREE,
+	SLOT_READING,
+	SLOT_CONVERTING,
+	SLOT_CONVERTED,
+};
+
+typedef struct {
+	GLuint pbo;
+	GLsync fence;
+	const uint8_t *mapped;
+	int state;
+} CaptureSlot;
+
+struct Capture {
+	int fd;
+	int width;
+	int height;
+	int fps;
+	GLuint tex;
+	GLuint fbo;
+	uint8_t *yuv;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	// slots are used strictly in turn, so frames stay in order
+	CaptureSlot slots[CAPTURE_SLOTS];
+	uint64_t issued;
+	uint64_t mapped;
+
+	// guarded by lock, as is the state of each slot
+	int queue[CAPTURE_SLOTS];
+	int queueHead;
+	int queueLength;
+	bool stopping;
+	bool failed;
+
+	uint64_t captured;
+	uint64_t dropped;
+	uint64_t written;
+};
+
+static void *captureWorker(void *arg) {
+	struct Capture *c = arg;
+	size_t lumaSize = (size_t) c->width * c->height;
+	size_t frameSize = lumaSize * 3 / 2;
+
+	char header[128];
+	int headerLen = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+		c->width, c->height, c->fps);
+	bool failed = !rlawtWriteAll(c->fd, header, headerLen);
+
+	pthread_mutex_lock(&c->lock);
+	c->failed |= failed;
+	for (;;) {
+		while (c->queueLength == 0 && !c->stopping) {
+			pthread_cond_wait(&c->cond, &c->lock);
+		}
+		if (c->queueLength == 0) {
+			break;
+		}
+
+		CaptureSlot *slot = &c->slots[c->queue[c->queueHead]];
+		c->queueHead = (c->queueHead + 1) % CAPTURE_SLOTS;
+		c->queueLength--;
+		failed = c->failed;
+		pthread_mutex_unlock(&c->lock);
+
+		rlawtBgraToI420(slot->mapped, (ptrdiff_t) c->width * 4, c->width, c->height,
+			c->yuv, c->yuv + lumaSize, c->yuv + lumaSize + lumaSize / 4);
+
+		// the render thread can unmap the buffer while we write
+		pthread_mutex_lock(&c->lock);
+		slot->state = SLOT_CONVERTED;
+		pthread_mutex_unlock(&c->lock);
+
+		if (!failed) {
+			failed = !rlawtWriteAll(c->fd, "FRAME\n", 6)
+				|| !rlawtWriteAll(c->fd, c->yuv, frameSize);
+		}
+
+		pthread_mutex_lock(&c->lock);
+		c->failed |= failed;
+		if (!failed) {
+			c->written++;
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+	return NULL;
+}
+
+// Unmaps buffers the worker has finished converting, and hands completed
+// readbacks to it in the order they were issued
+static void captureCollect(struct Capture *c, bool wait) {
+	pthread_mutex_lock(&c->lock);
+	for (int i = 0; i < CAPTURE_SLOTS; i++) {
+		CaptureSlot *slot = &c->slots[i];
+		if (slot->state == SLOT_CONVERTED) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slot->mapped = NULL;
+			slot->state = SLOT_FREE;
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	while (c->mapped < c->issued) {
+		int index = c->mapped % CAPTURE_SLOTS;
+		CaptureSlot *slot = &c->slots[index];
+
+		GLenum status = glClientWaitSync(slot->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(slot->fence);
+		slot->fence = NULL;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+		const uint8_t *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) c->width * c->height * 4, GL_MAP_READ_BIT);
+		c->mapped++;
+
+		pthread_mutex_lock(&c->lock);
+		if (mapped) {
+			slot->mapped = mapped;
+			slot->state = SLOT_CONVERTING;
+			c->queue[(c->queueHead + c->queueLength) % CAPTURE_SLOTS] = index;
+			c->queueLength++;
+			pthread_cond_signal(&c->cond);
+		} else {
+			slot->state = SLOT_FREE;
+			c->dropped++;
+		}
+		pthread_mutex_unlock(&c->lock);
+	}
+}
+
+// Blits the back buffer, flipped and scaled to the capture size, into a
+// texture and starts reading it back into the next free slot. Must be called
+// with the context current, before its buffers are swapped.
+void rlawtCaptureFrame(AWTContext *ctx) {
+	struct Capture *c = ctx->capture;
+
+	GLint oldDrawFbo, oldReadFbo, oldPackBuffer, oldReadBuffer;
+	GLint oldAlignment, oldRowLength, oldSkipPixels, oldSkipRows, oldTex, oldUnpackBuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &oldAlignment);
+	glGetIntegerv(GL_PACK_ROW_LENGTH, &oldRowLength);
+	glGetIntegerv(GL_PACK_SKIP_PIXELS, &oldSkipPixels);
+	glGetIntegerv(GL_PACK_SKIP_ROWS, &oldSkipRows);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &oldUnpackBuffer);
+	GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+	captureCollect(c, false);
+
+	CaptureSlot *slot = &c->slots[c->issued % CAPTURE_SLOTS];
+	pthread_mutex_lock(&c->lock);
+	bool available = slot->state == SLOT_FREE;
+	if (!available) {
+		// the encoder is falling behind
+		c->dropped++;
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	if (!available || ctx->width <= 0 || ctx->height <= 0) {
+		goto restore;
+	}
+
+	// multisampled buffers can only be resolved unscaled and unflipped
+	GLuint readFbo = 0;
+	if (ctx->multisamples > 0) {
+		readFbo = rlawtResolveBackBuffer(ctx);
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, c->fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+	if (!readFbo) {
+		glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+		glReadBuffer(ctx->doubleBuffered ? GL_BACK : GL_FRONT);
+	}
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(
+		0, 0, ctx->width, ctx->height,
+		0, c->height, c->width, 0,
+		GL_COLOR_BUFFER_BIT, c->width != ctx->width || c->height != ctx->height ? GL_LINEAR : GL_NEAREST);
+	if (!readFbo) {
+		glReadBuffer(oldReadBuffer);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, c->fbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+	glReadPixels(0, 0, c->width, c->height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	c->issued++;
+
+	pthread_mutex_lock(&c->lock);
+	slot->state = SLOT_READING;
+	c->captured++;
+	pthread_mutex_unlock(&c->lock);
+
+restore:
+	if (scissor) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, oldAlignment);
+	glPixelStorei(GL_PACK_ROW_LENGTH, oldRowLength);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, oldSkipPixels);
+	glPixelStorei(GL_PACK_SKIP_ROWS, oldSkipRows);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, oldUnpackBuffer);
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+}
+
+// Finishes the frames already read back if the context is current, then
+// stops the worker and closes the output. Returns false if any frame could
+// not be written.
+static bool captureStop(AWTContext *ctx) {
+	struct Capture *c = ctx->capture;
+	ctx->capture = NULL;
+
+	bool current = rlawtIsCurrent(ctx);
+	GLint oldPackBuffer = 0;
+	if (current) {
+		glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+		captureCollect(c, true);
+	}
+
+	pthread_mutex_lock(&c->lock);
+	c->stopping = true;
+	pthread_cond_signal(&c->cond);
+	pthread_mutex_unlock(&c->lock);
+	pthread_join(c->thread, NULL);
+
+	if (current) {
+		for (int i = 0; i < CAPTURE_SLOTS; i++) {
+			if (c->slots[i].mapped) {
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, c->slots[i].pbo);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			if (c->slots[i].fence) {
+				glDeleteSync(c->slots[i].fence);
+			}
+			glDeleteBuffers(1, &c->slots[i].pbo);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+		glDeleteFramebuffers(1, &c->fbo);
+		glDeleteTextures(1, &c->tex);
+	}
+
+	bool ok = !c->failed && close(c->fd) == 0;
+	pthread_cond_destroy(&c->cond);
+	pthread_mutex_destroy(&c->lock);
+	free(c->yuv);
+	free(c);
+	return ok;
+}
+
+void rlawtCaptureFree(AWTContext *ctx) {
+	if (ctx->capture) {
+		captureStop(ctx);
+	}
+}
+
+// The framebuffer didn't survive the context being replaced, but the texture it wraps did
+void rlawtCaptureRecreate(AWTContext *ctx) {
+	struct Capture *c = ctx->capture;
+	if (!c) {
+		return;
+	}
+
+	GLint oldDrawFbo;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGenFramebuffers(1, &c->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, c->fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, c->tex, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_startCapture(JNIEnv *env, jobject self, jstring jpath, jint width, jint height, jint fps) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (ctx->capture) {
+		rlawtThrow(env, "already capturing");
+		return;
+	}
+
+	if (!jpath) {
+		rlawtThrow(env, "capture path is null");
+		return;
+	}
+
+	if (width <= 0 || height <= 0) {
+		width = ctx->width;
+		height = ctx->height;
+	}
+	// i420 needs even dimensions
+	width &= ~1;
+	height &= ~1;
+	if (width <= 0 || height <= 0 || fps <= 0) {
+		rlawtThrow(env, "invalid capture size");
+		return;
+	}
+
+	struct Capture *c = calloc(1, sizeof(*c));
+	uint8_t *yuv = malloc((size_t) width * height * 3 / 2);
+	if (!c || !yuv) {
+		free(c);
+		free(yuv);
+		rlawtThrow(env, "unable to allocate capture");
+		return;
+	}
+	c->yuv = yuv;
+	c->width = width;
+	c->height = height;
+	c->fps = fps;
+
+	const char *path = (*env)->GetStringUTFChars(env, jpath, NULL);
+	if (!path) {
+		goto freeCapture;
+	}
+	c->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	(*env)->ReleaseStringUTFChars(env, jpath, path);
+	if (c->fd < 0) {
+		rlawtThrow(env, "unable to open capture output");
+		goto freeCapture;
+	}
+
+	pthread_mutex_init(&c->lock, NULL);
+	pthread_cond_init(&c->cond, NULL);
+	if (pthread_create(&c->thread, NULL, captureWorker, c)) {
+		rlawtThrow(env, "unable to start capture worker");
+		pthread_cond_destroy(&c->cond);
+		pthread_mutex_destroy(&c->lock);
+		close(c->fd);
+		goto freeCapture;
+	}
+
+	GLint oldTex, oldUnpackBuffer, oldPackBuffer;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &oldUnpackBuffer);
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+
+	glGenTextures(1, &c->tex);
+	glBindTexture(GL_TEXTURE_2D, c->tex);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	GLint oldDrawFbo;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGenFramebuffers(1, &c->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, c->fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, c->tex, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+
+	for (int i = 0; i < CAPTURE_SLOTS; i++) {
+		glGenBuffers(1, &c->slots[i].pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, c->slots[i].pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 4, NULL, GL_STREAM_READ);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, oldUnpackBuffer);
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+
+	ctx->capture = c;
+	return;
+
+freeCapture:
+	free(c->yuv);
+	free(c);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_stopCapture(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !ctx->capture) {
+		return;
+	}
+
+	if (!captureStop(ctx)) {
+		rlawtThrow(env, "unable to write capture");
+	}
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getCaptureStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	jlong stats[3] = {0};
+	struct Capture *c = ctx->capture;
+	if (c) {
+		pthread_mutex_lock(&c->lock);
+		stats[0] = c->captured;
+		stats[1] = c->dropped;
+		stats[2] = c->written;
+		pthread_mutex_unlock(&c->lock);
+	}
+
+	jlongArray array = (*env)->NewLongArray(env, 3);
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, 3, stats);
+	}
+	return array;
+}
+
+#endif
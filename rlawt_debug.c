@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// longer messages are truncated
+#define DEBUG_MESSAGE_LENGTH 240
+#define MAX_IGNORED_IDS 64
+
+typedef struct {
+	_Atomic uint64_t seq;
+	uint32_t source;
+	uint32_t type;
+	uint32_t id;
+	uint32_t severity;
+	uint32_t length;
+	char message[DEBUG_MESSAGE_LENGTH];
+} DebugSlot;
+
+// A bounded multi producer, single consumer queue. Drivers may call back
+// from their own threads, so producers claim slots with a CAS on head, and a
+// slot's seq says whether it is free for the producer at that position or
+// holds a message for the consumer. Messages are dropped rather than waited
+// for when the ring is full.
+struct DebugRing {
+	uint32_t capacity;
+	_Atomic uint64_t head;
+	uint64_t tail;
+
+	_Atomic uint64_t received;
+	_Atomic uint64_t dropped;
+	_Atomic uint64_t ignored;
+
+	_Atomic int numIgnoredIds;
+	_Atomic GLuint ignoredIds[MAX_IGNORED_IDS];
+
+	// what startDebugMessages and stopDebugMessages set up, so a replacement context can get it too
+	int minSeverity;
+	bool enabled;
+
+	DebugSlot slots[];
+};
+
+static void GLAPIENTRY onDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam) {
+	struct DebugRing *ring = (struct DebugRing*) userParam;
+	atomic_fetch_add_explicit(&ring->received, 1, memory_order_relaxed);
+
+	int numIgnored = atomic_load_explicit(&ring->numIgnoredIds, memory_order_acquire);
+	for (int i = 0; i < numIgnored; i++) {
+		if (atomic_load_explicit(&ring->ignoredIds[i], memory_order_relaxed) == id) {
+			atomic_fetch_add_explicit(&ring->ignored, 1, memory_order_relaxed);
+			return;
+		}
+	}
+
+	uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	DebugSlot *slot;
+	for (;;) {
+		slot = &ring->slots[pos & (ring->capacity - 1)];
+		uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		if (seq == pos) {
+			if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (seq < pos) {
+			atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+			return;
+		} else {
+			pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		}
+	}
+
+	if (length < 0) {
+		length = strlen(message);
+	}
+	if (length > DEBUG_MESSAGE_LENGTH) {
+		length = DEBUG_MESSAGE_LENGTH;
+	}
+	slot->source = source;
+	slot->type = type;
+	slot->id = id;
+	slot->severity = severity;
+	slot->length = length;
+	memcpy(slot->message, message, length);
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+static void applySeverity(int minSeverity) {
+	static const GLenum severities[] = {
+		GL_DEBUG_SEVERITY_NOTIFICATION,
+		GL_DEBUG_SEVERITY_LOW,
+		GL_DEBUG_SEVERITY_MEDIUM,
+		GL_DEBUG_SEVERITY_HIGH,
+	};
+	for (int i = 0; i < (int) (sizeof(severities) / sizeof(severities[0])); i++) {
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severities[i], 0, NULL, i >= minSeverity);
+	}
+}
+
+static void installDebugOutput(struct DebugRing *ring) {
+	glDebugMessageCallback(onDebugMessage, ring);
+	applySeverity(ring->minSeverity);
+	// asynchronous output keeps the driver from serializing on our callback
+	glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	if (ring->enabled) {
+		glEnable(GL_DEBUG_OUTPUT);
+	} else {
+		glDisable(GL_DEBUG_OUTPUT);
+	}
+}
+
+// The callback and message controls are context state, so a context which
+// replaced ctx->context has to be set up again. Must be current.
+void rlawtDebugRecreate(AWTContext *ctx) {
+	if (ctx->debug) {
+		installDebugOutput(ctx->debug);
+	}
+}
+
+// Drivers may call back from their own threads at any time, so the ring
+// lives as long as the context does
+void rlawtDebugFree(AWTContext *ctx) {
+	free(ctx->debug);
+	ctx->debug = NULL;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_configureDebugContext(JNIEnv *env, jobject self, jboolean debug) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, false)) {
+		return;
+	}
+
+	ctx->debugContext = debug;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_startDebugMessages(JNIEnv *env, jobject self, jint capacity, jint minSeverity) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (!ctx->debugContext) {
+		rlawtThrow(env, "context was not created for debugging");
+		return;
+	}
+	if (capacity < 2 || capacity > (1 << 20) || (capacity & (capacity - 1))) {
+		rlawtThrow(env, "capacity must be a power of two");
+		return;
+	}
+
+	if (ctx->debug && ctx->debug->capacity != (uint32_t) capacity) {
+		rlawtThrow(env, "debug ring capacity cannot change");
+		return;
+	}
+
+	if (!ctx->debug) {
+		struct DebugRing *ring = calloc(1, sizeof(*ring) + capacity * sizeof(DebugSlot));
+		if (!ring) {
+			rlawtThrow(env, "unable to allocate debug ring");
+			return;
+		}
+		ring->capacity = capacity;
+		for (int i = 0; i < capacity; i++) {
+			atomic_init(&ring->slots[i].seq, i);
+		}
+		ctx->debug = ring;
+	}
+
+	ctx->debug->minSeverity = minSeverity;
+	ctx->debug->enabled = true;
+	installDebugOutput(ctx->debug);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_stopDebugMessages(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (ctx->debug) {
+		ctx->debug->enabled = false;
+		glDisable(GL_DEBUG_OUTPUT);
+	}
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setIgnoredDebugMessages(JNIEnv *env, jobject self, jintArray jids) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return;
+	}
+
+	struct DebugRing *ring = ctx->debug;
+	if (!ring) {
+		rlawtThrow(env, "debug messages are not started");
+		return;
+	}
+
+	jsize count = jids ? (*env)->GetArrayLength(env, jids) : 0;
+	if (count > MAX_IGNORED_IDS) {
+		rlawtThrow(env, "too many ignored ids");
+		return;
+	}
+
+	jint ids[MAX_IGNORED_IDS];
+	if (count > 0) {
+		(*env)->GetIntArrayRegion(env, jids, 0, count, ids);
+	}
+
+	// shrink the list before rewriting it, so callbacks racing with us only see whole ids
+	atomic_store_explicit(&ring->numIgnoredIds, 0, memory_order_release);
+	for (int i = 0; i < count; i++) {
+		atomic_store_explicit(&ring->ignoredIds[i], (GLuint) ids[i], memory_order_relaxed);
+	}
+	atomic_store_explicit(&ring->numIgnoredIds, count, memory_order_release);
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_drainDebugMessages(JNIEnv *env, jobject self, jobject buffer) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return 0;
+	}
+
+	struct DebugRing *ring = ctx->debug;
+	if (!ring) {
+		return 0;
+	}
+
+	uint8_t *out = (*env)->GetDirectBufferAddress(env, buffer);
+	jlong capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+	if (!out || capacity < 0) {
+		rlawtThrow(env, "buffer must be direct");
+		return 0;
+	}
+
+	jint count = 0;
+	jlong offset = 0;
+	for (;;) {
+		DebugSlot *slot = &ring->slots[ring->tail & (ring->capacity - 1)];
+		if (atomic_load_explicit(&slot->seq, memory_order_acquire) != ring->tail + 1) {
+			break;
+		}
+
+		uint32_t header[5] = {slot->source, slot->type, slot->id, slot->severity, slot->length};
+		jlong size = sizeof(header) + ((slot->length + 3) & ~3u);
+		if (offset + size > capacity) {
+			break;
+		}
+		memcpy(out + offset, header, sizeof(header));
+		memcpy(out + offset + sizeof(header), slot->message, slot->length);
+		offset += size;
+		count++;
+
+		atomic_store_explicit(&slot->seq, ring->tail + ring->capacity, memory_order_release);
+		ring->tail++;
+	}
+	return count;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getDebugStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	struct DebugRing *ring = ctx->debug;
+	jlong stats[] = {
+		ring ? atomic_load_explicit(&ring->received, memory_order_relaxed) : 0,
+		ring ? atomic_load_explicit(&ring->dropped, memory_order_relaxed) : 0,
+		ring ? atomic_load_explicit(&ring->ignored, memory_order_relaxed) : 0,
+	};
+
+	jlongArray array = (*env)->NewLongArray(env, sizeof(stats) / sizeof(stats[0]));
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, sizeof(stats) / sizeof(stats[0]), stats);
+	}
+	return array;
+}
+
+#endif
@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_DMABUF_IMAGES 8
+
+typedef struct {
+	GLuint tex;
+	GLuint fbo;
+	EGLImageKHR image;
+	int fd;
+	EGLint stride;
+	EGLint offset;
+	EGLuint64KHR modifier;
+	GLsync fence;
+	uint64_t frame;
+} DmaBufImage;
+
+struct DmaBufRing {
+	PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR;
+	PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR;
+	PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC eglExportDMABUFImageQueryMESA;
+	PFNEGLEXPORTDMABUFIMAGEMESAPROC eglExportDMABUFImageMESA;
+
+	int count;
+	int width;
+	int height;
+	int fourcc;
+	uint64_t generation;
+	GLuint depthStencil;
+
+	// the app renders into current; presented was shown by the last swap
+	int current;
+	int presented;
+	uint64_t frame;
+	uint64_t polled;
+	DmaBufImage images[MAX_DMABUF_IMAGES];
+};
+
+static void releaseImage(struct DmaBufRing *ring, EGLDisplay display, DmaBufImage *img) {
+	if (img->fd >= 0) {
+		close(img->fd);
+		img->fd = -1;
+	}
+	if (img->image != EGL_NO_IMAGE_KHR) {
+		ring->eglDestroyImageKHR(display, img->image);
+		img->image = EGL_NO_IMAGE_KHR;
+	}
+}
+
+// (Re)allocates every image at the canvas size and exports it. Images are
+// only single plane RGBA8, which is all Mesa's software rasterizers export.
+// Must be called with the context current.
+static bool allocateRing(AWTContext *ctx) {
+	struct DmaBufRing *ring = ctx->dmaBuf;
+	int width = ctx->width > 0 ? ctx->width : 1;
+	int height = ctx->height > 0 ? ctx->height : 1;
+	bool ok = false;
+
+	GLint oldTex, oldFbo, oldRenderbuffer, oldUnpackBuffer;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldFbo);
+	glGetIntegerv(GL_RENDERBUFFER_BINDING, &oldRenderbuffer);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &oldUnpackBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (ctx->depthDepth > 0 || ctx->stencilDepth > 0) {
+		if (!ring->depthStencil) {
+			glGenRenderbuffers(1, &ring->depthStencil);
+		}
+		glBindRenderbuffer(GL_RENDERBUFFER, ring->depthStencil);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	}
+
+	ring->generation++;
+	ring->width = width;
+	ring->height = height;
+	for (int i = 0; i < ring->count; i++) {
+		DmaBufImage *img = &ring->images[i];
+		releaseImage(ring, ctx->eglDisplay, img);
+		if (img->fence) {
+			glDeleteSync(img->fence);
+			img->fence = NULL;
+		}
+		img->frame = 0;
+
+		// redefining a texture which is an image sibling orphans it, so each resize gets a new one
+		if (img->tex) {
+			glDeleteTextures(1, &img->tex);
+		} else {
+			glGenFramebuffers(1, &img->fbo);
+		}
+		glGenTextures(1, &img->tex);
+		glBindTexture(GL_TEXTURE_2D, img->tex);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, img->fbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, img->tex, 0);
+		if (ring->depthStencil) {
+			glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, ring->depthStencil);
+		}
+		if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			goto restore;
+		}
+
+		EGLint attribs[] = {
+			EGL_GL_TEXTURE_LEVEL_KHR, 0,
+			EGL_NONE,
+		};
+		img->image = ring->eglCreateImageKHR(ctx->eglDisplay, ctx->eglContext, EGL_GL_TEXTURE_2D_KHR, (EGLClientBuffer) (uintptr_t) img->tex, attribs);
+		if (img->image == EGL_NO_IMAGE_KHR) {
+			goto restore;
+		}
+
+		int fourcc, planes;
+		EGLuint64KHR modifier = 0;
+		if (!ring->eglExportDMABUFImageQueryMESA(ctx->eglDisplay, img->image, &fourcc, &planes, &modifier) || planes != 1) {
+			goto restore;
+		}
+		if (!ring->eglExportDMABUFImageMESA(ctx->eglDisplay, img->image, &img->fd, &img->stride, &img->offset)) {
+			img->fd = -1;
+			goto restore;
+		}
+		img->modifier = modifier;
+		ring->fourcc = fourcc;
+	}
+	ok = true;
+
+restore:
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldFbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, oldRenderbuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, oldUnpackBuffer);
+	ring->current = 0;
+	ring->presented = -1;
+	return ok;
+}
+
+static EGLDisplay getDisplay(Display *dpy) {
+	const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (rlawtHasExtension(clientExtensions, "EGL_EXT_platform_x11")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (eglGetPlatformDisplayEXT) {
+			return eglGetPlatformDisplayEXT(EGL_PLATFORM_X11_EXT, dpy, NULL);
+		}
+	}
+	return eglGetDisplay((EGLNativeDisplayType) dpy);
+}
+
+static EGLConfig chooseConfig(AWTContext *ctx) {
+	// the window only ever receives a blit from the ring, so it needs no ancillary buffers
+	EGLint attribs[] = {
+		EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, ctx->alphaDepth,
+		EGL_NONE,
+	};
+
+	EGLConfig configs[64];
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(ctx->eglDisplay, attribs, configs, sizeof(configs) / sizeof(configs[0]), &numConfigs) || numConfigs < 1) {
+		return NULL;
+	}
+
+	for (int i = 0; i < numConfigs; i++) {
+		EGLint visualID = 0;
+		eglGetConfigAttrib(ctx->eglDisplay, configs[i], EGL_NATIVE_VISUAL_ID, &visualID);
+		if ((VisualID) visualID == ctx->visualID) {
+			return configs[i];
+		}
+	}
+	return configs[0];
+}
+
+// Creates an EGL context on the window and the exported image ring, and
+// makes it current. ctx->dpy must already be open.
+bool rlawtEGLCreate(JNIEnv *env, AWTContext *ctx) {
+	if (ctx->multisamples > 0) {
+		rlawtThrow(env, "multisampling is not supported with dma-buf export");
+		return false;
+	}
+
+	ctx->eglDisplay = getDisplay(ctx->dpy);
+	if (ctx->eglDisplay == EGL_NO_DISPLAY || !eglInitialize(ctx->eglDisplay, NULL, NULL)) {
+		rlawtThrow(env, "egl is not supported");
+		ctx->eglDisplay = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	const char *extensions = eglQueryString(ctx->eglDisplay, EGL_EXTENSIONS);
+	if (!rlawtHasExtension(extensions, "EGL_KHR_gl_texture_2D_image") || !rlawtHasExtension(extensions, "EGL_MESA_image_dma_buf_export")) {
+		rlawtThrow(env, "dma-buf export is not supported");
+		goto terminate;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		rlawtThrow(env, "egl does not support opengl");
+		goto terminate;
+	}
+
+	EGLConfig config = chooseConfig(ctx);
+	if (!config) {
+		rlawtThrow(env, "unable to find an egl config");
+		goto terminate;
+	}
+
+	EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+		EGL_CONTEXT_FLAGS_KHR, ctx->debugContext ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0,
+		EGL_NONE,
+	};
+	ctx->eglContext = eglCreateContext(ctx->eglDisplay, config, EGL_NO_CONTEXT,
+		rlawtHasExtension(extensions, "EGL_KHR_create_context") ? contextAttribs : NULL);
+	if (ctx->eglContext == EGL_NO_CONTEXT) {
+		rlawtThrow(env, "unable to create egl context");
+		goto terminate;
+	}
+
+	ctx->eglSurface = eglCreateWindowSurface(ctx->eglDisplay, config, (EGLNativeWindowType) ctx->drawable, NULL);
+	if (ctx->eglSurface == EGL_NO_SURFACE) {
+		rlawtThrow(env, "unable to create egl surface");
+		goto destroyContext;
+	}
+
+	if (!eglMakeCurrent(ctx->eglDisplay, ctx->eglSurface, ctx->eglSurface, ctx->eglContext)) {
+		rlawtThrow(env, "unable to make current");
+		goto destroySurface;
+	}
+	ctx->doubleBuffered = true;
+
+	struct DmaBufRing *ring = calloc(1, sizeof(*ring));
+	if (!ring) {
+		rlawtThrow(env, "unable to allocate dma-buf ring");
+		goto release;
+	}
+	ring->eglCreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
+	ring->eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
+	ring->eglExportDMABUFImageQueryMESA = (PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC) eglGetProcAddress("eglExportDMABUFImageQueryMESA");
+	ring->eglExportDMABUFImageMESA = (PFNEGLEXPORTDMABUFIMAGEMESAPROC) eglGetProcAddress("eglExportDMABUFImageMESA");
+	ring->count = ctx->dmaBufImages;
+	for (int i = 0; i < ring->count; i++) {
+		ring->images[i].fd = -1;
+		ring->images[i].image = EGL_NO_IMAGE_KHR;
+	}
+	ctx->dmaBuf = ring;
+
+	if (!ring->eglCreateImageKHR || !ring->eglDestroyImageKHR
+		|| !ring->eglExportDMABUFImageQueryMESA || !ring->eglExportDMABUFImageMESA
+		|| !allocateRing(ctx)) {
+		rlawtThrow(env, "unable to export dma-buf");
+		rlawtEGLDestroy(ctx);
+		return false;
+	}
+	return true;
+
+release:
+	eglMakeCurrent(ctx->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+destroySurface:
+	eglDestroySurface(ctx->eglDisplay, ctx->eglSurface);
+	ctx->eglSurface = EGL_NO_SURFACE;
+destroyContext:
+	eglDestroyContext(ctx->eglDisplay, ctx->eglContext);
+	ctx->eglContext = EGL_NO_CONTEXT;
+terminate:
+	eglTerminate(ctx->eglDisplay);
+	ctx->eglDisplay = EGL_NO_DISPLAY;
+	return false;
+}
+
+// The display connection is private to this context, so terminating its EGL
+// display cannot affect any other context
+void rlawtEGLDestroy(AWTContext *ctx) {
+	struct DmaBufRing *ring = ctx->dmaBuf;
+	if (ring) {
+		ctx->dmaBuf = NULL;
+		bool current = eglGetCurrentContext() == ctx->eglContext;
+		for (int i = 0; i < ring->count; i++) {
+			DmaBufImage *img = &ring->images[i];
+			releaseImage(ring, ctx->eglDisplay, img);
+			if (current) {
+				if (img->fence) {
+					glDeleteSync(img->fence);
+				}
+				glDeleteTextures(1, &img->tex);
+				glDeleteFramebuffers(1, &img->fbo);
+			}
+		}
+		if (current) {
+			glDeleteRenderbuffers(1, &ring->depthStencil);
+		}
+		free(ring);
+	}
+
+	if (eglGetCurrentContext() == ctx->eglContext) {
+		eglMakeCurrent(ctx->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	}
+	eglDestroySurface(ctx->eglDisplay, ctx->eglSurface);
+	eglDestroyContext(ctx->eglDisplay, ctx->eglContext);
+	eglTerminate(ctx->eglDisplay);
+	ctx->eglSurface = EGL_NO_SURFACE;
+	ctx->eglContext = EGL_NO_CONTEXT;
+	ctx->eglDisplay = EGL_NO_DISPLAY;
+}
+
+GLuint rlawtDmaBufFramebuffer(AWTContext *ctx, bool front) {
+	struct DmaBufRing *ring = ctx->dmaBuf;
+	if (front && ring->presented >= 0) {
+		return ring->images[ring->presented].fbo;
+	}
+	return ring->images[ring->current].fbo;
+}
+
+// Shows the image the app just rendered on the window and moves on to the
+// next one, overwriting the oldest. Runs before every other present pass so
+// they all see the frame in the back buffer.
+bool rlawtDmaBufPresent(AWTContext *ctx) {
+	struct DmaBufRing *ring = ctx->dmaBuf;
+	DmaBufImage *img = &ring->images[ring->current];
+
+	GLint oldDrawFbo, oldReadFbo;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, img->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(
+		0, 0, ring->width, ring->height,
+		0, 0, ctx->width, ctx->height,
+		GL_COLOR_BUFFER_BIT, ring->width == ctx->width && ring->height == ctx->height ? GL_NEAREST : GL_LINEAR);
+
+	if (img->fence) {
+		glDeleteSync(img->fence);
+	}
+	img->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	img->frame = ++ring->frame;
+	ring->presented = ring->current;
+	ring->current = (ring->current + 1) % ring->count;
+
+	bool ok = true;
+	if (ctx->width > 0 && ctx->height > 0 && (ctx->width != ring->width || ctx->height != ring->height)) {
+		ok = allocateRing(ctx);
+	}
+
+	if (scissor) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+	return ok;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_configureDmaBufExport(JNIEnv *env, jobject self, jint images) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, false)) {
+		return;
+	}
+
+	if (images != 0 && (images < 2 || images > MAX_DMABUF_IMAGES)) {
+		rlawtThrow(env, "invalid dma-buf image count");
+		return;
+	}
+
+	ctx->dmaBufImages = images;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getDmaBufImages(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	struct DmaBufRing *ring = ctx->dmaBuf;
+	if (!ring) {
+		rlawtThrow(env, "dma-buf export is not configured");
+		return NULL;
+	}
+
+	jlong info[4 + MAX_DMABUF_IMAGES * 4];
+	int n = 0;
+	info[n++] = ring->generation;
+	info[n++] = ring->width;
+	info[n++] = ring->height;
+	info[n++] = ring->fourcc;
+	for (int i = 0; i < ring->count; i++) {
+		info[n++] = ring->images[i].fd;
+		info[n++] = ring->images[i].stride;
+		info[n++] = ring->images[i].offset;
+		info[n++] = (jlong) ring->images[i].modifier;
+	}
+
+	jlongArray array = (*env)->NewLongArray(env, n);
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, n, info);
+	}
+	return array;
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_pollDmaBufFrame(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return -1;
+	}
+
+	struct DmaBufRing *ring = ctx->dmaBuf;
+	if (!ring) {
+		rlawtThrow(env, "dma-buf export is not configured");
+		return -1;
+	}
+
+	int newest = -1;
+	for (int i = 0; i < ring->count; i++) {
+		DmaBufImage *img = &ring->images[i];
+		if (i == ring->current || img->frame <= ring->polled) {
+			continue;
+		}
+		if (img->fence) {
+			GLenum status = glClientWaitSync(img->fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				continue;
+			}
+			glDeleteSync(img->fence);
+			img->fence = NULL;
+		}
+		if (newest < 0 || img->frame > ring->images[newest].frame) {
+			newest = i;
+		}
+	}
+
+	if (newest >= 0) {
+		ring->polled = ring->images[newest].frame;
+	}
+	return newest;
+}
+
+#endif
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Shared memory layout, all little endian. The header is followed by
+// slotCount slots of slotSize bytes, each a FrameSlot followed by top down
+// BGRA rows of stride bytes.
+//
+// Each slot is a seqlock: seq is odd while the producer writes it. A consumer
+// reads seq, then the frame, then seq again, and discards the frame if either
+// read was odd or they differ. The newest frame is in slot
+// (latest % slotCount), and the producer only ever overwrites the oldest, so a
+// consumer has slotCount - 1 frames of time to use a frame in place.
+//
+// frameCounter is incremented after every frame. Consumers may increment
+// waiters and FUTEX_WAIT on it, without FUTEX_PRIVATE_FLAG, to be woken on new
+// frames; the producer never waits for them.
+#define FRAMESERVER_MAGIC "RLFRAME1"
+#define FRAMESERVER_VERSION 1
+#define FRAMESERVER_FORMAT_BGRA 0
+#define FRAMESERVER_READBACKS 3
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t slotCount;
+	uint32_t slotSize;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+	uint32_t format;
+	uint32_t producerPid;
+	_Atomic uint32_t closed;
+	_Atomic uint32_t frameCounter;
+	_Atomic uint32_t waiters;
+	uint32_t reserved;
+	_Atomic uint64_t latest;
+} FrameServerHeader;
+
+typedef struct {
+	_Atomic uint32_t seq;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+	uint64_t frame;
+	uint64_t timestamp;
+	uint8_t reserved[32];
+} FrameSlot;
+
+typedef struct {
+	GLuint pbo;
+	GLsync fence;
+	int width;
+	int height;
+	uint64_t timestamp;
+} FrameReadback;
+
+struct FrameServer {
+	char *name;
+	uint8_t *map;
+	size_t mapSize;
+	FrameServerHeader *header;
+	uint64_t frame;
+
+	GLuint tex;
+	GLuint fbo;
+	RenderTargetSize texSize;
+
+	// used strictly in turn, so frames are published in order
+	FrameReadback readbacks[FRAMESERVER_READBACKS];
+	uint64_t issued;
+	uint64_t published;
+};
+
+static void publish(struct FrameServer *fs, FrameReadback *rb, const uint8_t *pixels) {
+	FrameServerHeader *h = fs->header;
+	uint64_t frame = ++fs->frame;
+	FrameSlot *slot = (FrameSlot*) (fs->map + h->headerSize + (frame % h->slotCount) * h->slotSize);
+	uint8_t *dst = (uint8_t*) (slot + 1);
+	size_t stride = (size_t) rb->width * 4;
+
+	uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	slot->width = rb->width;
+	slot->height = rb->height;
+	slot->stride = stride;
+	slot->frame = frame;
+	slot->timestamp = rb->timestamp;
+	// read back bottom up
+	for (int y = 0; y < rb->height; y++) {
+		memcpy(dst + y * stride, pixels + (size_t) (rb->height - 1 - y) * stride, stride);
+	}
+
+	atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+	atomic_store_explicit(&h->latest, frame, memory_order_release);
+	atomic_fetch_add_explicit(&h->frameCounter, 1, memory_order_release);
+	if (atomic_load_explicit(&h->waiters, memory_order_acquire)) {
+		syscall(SYS_futex, &h->frameCounter, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+	}
+}
+
+// Publishes completed readbacks in the order they were issued
+static void collect(struct FrameServer *fs) {
+	while (fs->published < fs->issued) {
+		FrameReadback *rb = &fs->readbacks[fs->published % FRAMESERVER_READBACKS];
+		GLenum status = glClientWaitSync(rb->fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(rb->fence);
+		rb->fence = NULL;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		const uint8_t *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) rb->width * rb->height * 4, GL_MAP_READ_BIT);
+		if (pixels) {
+			publish(fs, rb, pixels);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		fs->published++;
+	}
+}
+
+// Publishes finished readbacks and starts reading back the back buffer,
+// scaled down to fit the slots if needed. Frames are skipped rather than
+// waited for when every readback is still in flight. Must be called with the
+// context current, before its buffers are swapped.
+void rlawtFrameServerFrame(AWTContext *ctx) {
+	struct FrameServer *fs = ctx->frameServer;
+
+	GLint oldDrawFbo, oldReadFbo, oldPackBuffer, oldUnpackBuffer, oldTex, oldReadBuffer;
+	GLint oldAlignment, oldRowLength, oldSkipPixels, oldSkipRows;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &oldUnpackBuffer);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &oldAlignment);
+	glGetIntegerv(GL_PACK_ROW_LENGTH, &oldRowLength);
+	glGetIntegerv(GL_PACK_SKIP_PIXELS, &oldSkipPixels);
+	glGetIntegerv(GL_PACK_SKIP_ROWS, &oldSkipRows);
+	GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+	collect(fs);
+
+	if (fs->issued - fs->published >= FRAMESERVER_READBACKS || ctx->width <= 0 || ctx->height <= 0) {
+		goto restore;
+	}
+
+	int width = ctx->width;
+	int height = ctx->height;
+	int maxWidth = fs->header->maxWidth;
+	int maxHeight = fs->header->maxHeight;
+	if (width > maxWidth || height > maxHeight) {
+		// keep the aspect ratio
+		if ((int64_t) width * maxHeight > (int64_t) height * maxWidth) {
+			height = (int) ((int64_t) height * maxWidth / width);
+			width = maxWidth;
+		} else {
+			width = (int) ((int64_t) width * maxHeight / height);
+			height = maxHeight;
+		}
+		width = width > 0 ? width : 1;
+		height = height > 0 ? height : 1;
+	}
+
+	GLuint readFbo = 0;
+	bool scaled = width != ctx->width || height != ctx->height;
+	if (ctx->multisamples > 0) {
+		readFbo = rlawtResolveBackBuffer(ctx);
+	}
+	if (scaled) {
+		if (!fs->tex) {
+			glGenTextures(1, &fs->tex);
+			glGenFramebuffers(1, &fs->fbo);
+		}
+		if (rlawtTargetResize(&fs->texSize, width, height)) {
+			glBindTexture(GL_TEXTURE_2D, fs->tex);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, fs->texSize.width, fs->texSize.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fs->fbo);
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fs->tex, 0);
+		}
+
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fs->fbo);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+		if (!readFbo) {
+			glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+			glReadBuffer(ctx->doubleBuffered ? GL_BACK : GL_FRONT);
+		}
+		glDisable(GL_SCISSOR_TEST);
+		glBlitFramebuffer(
+			0, 0, ctx->width, ctx->height,
+			0, 0, width, height,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		if (!readFbo) {
+			glReadBuffer(oldReadBuffer);
+		}
+		readFbo = fs->fbo;
+	}
+
+	FrameReadback *rb = &fs->readbacks[fs->issued % FRAMESERVER_READBACKS];
+	if (!rb->pbo) {
+		glGenBuffers(1, &rb->pbo);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+	if (rb->width != width || rb->height != height) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 4, NULL, GL_STREAM_READ);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+	if (!readFbo) {
+		glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+		glReadBuffer(ctx->doubleBuffered ? GL_BACK : GL_FRONT);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+	glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+	if (!readFbo) {
+		glReadBuffer(oldReadBuffer);
+	}
+
+	rb->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	rb->width = width;
+	rb->height = height;
+	rb->timestamp = rlawtNanoTime();
+	fs->issued++;
+
+restore:
+	if (scissor) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, oldAlignment);
+	glPixelStorei(GL_PACK_ROW_LENGTH, oldRowLength);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, oldSkipPixels);
+	glPixelStorei(GL_PACK_SKIP_ROWS, oldSkipRows);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, oldUnpackBuffer);
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+}
+
+// Marks the ring closed, wakes any waiting consumers and unlinks it. Mapped
+// consumers keep their view of the memory.
+void rlawtFrameServerFree(AWTContext *ctx) {
+	struct FrameServer *fs = ctx->frameServer;
+	if (!fs) {
+		return;
+	}
+	ctx->frameServer = NULL;
+
+	atomic_store_explicit(&fs->header->closed, 1, memory_order_release);
+	atomic_fetch_add_explicit(&fs->header->frameCounter, 1, memory_order_release);
+	syscall(SYS_futex, &fs->header->frameCounter, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+	if (rlawtIsCurrent(ctx)) {
+		for (int i = 0; i < FRAMESERVER_READBACKS; i++) {
+			if (fs->readbacks[i].fence) {
+				glDeleteSync(fs->readbacks[i].fence);
+			}
+			glDeleteBuffers(1, &fs->readbacks[i].pbo);
+		}
+		glDeleteTextures(1, &fs->tex);
+		glDeleteFramebuffers(1, &fs->fbo);
+	}
+
+	munmap(fs->map, fs->mapSize);
+	shm_unlink(fs->name);
+	free(fs->name);
+	free(fs);
+}
+
+// Forgetting the scaled texture's size makes the next frame reattach it
+void rlawtFrameServerRecreate(AWTContext *ctx) {
+	struct FrameServer *fs = ctx->frameServer;
+	if (fs && fs->fbo) {
+		glGenFramebuffers(1, &fs->fbo);
+		fs->texSize = (RenderTargetSize) {0};
+	}
+}
+
+// Whether name holds a ring which no producer will write again: one which was
+// closed, or whose producer died without closing it. Anything else, including
+// objects which aren't rings at all, belongs to someone else.
+static bool staleRing(const char *name) {
+	int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	FrameServerHeader *h = MAP_FAILED;
+	if (!fstat(fd, &st) && st.st_size >= (off_t) sizeof(*h)) {
+		h = mmap(NULL, sizeof(*h), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (h == MAP_FAILED) {
+		return false;
+	}
+
+	bool stale = !memcmp(h->magic, FRAMESERVER_MAGIC, 8)
+		&& (atomic_load_explicit(&h->closed, memory_order_acquire)
+			|| (kill((pid_t) h->producerPid, 0) && errno == ESRCH));
+	munmap(h, sizeof(*h));
+	return stale;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_startFrameServer(JNIEnv *env, jobject self, jstring jname, jint maxWidth, jint maxHeight, jint slots) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (ctx->frameServer) {
+		rlawtThrow(env, "frame server is already running");
+		return;
+	}
+
+	if (maxWidth <= 0 || maxHeight <= 0) {
+		maxWidth = ctx->width;
+		maxHeight = ctx->height;
+	}
+	if (maxWidth <= 0 || maxHeight <= 0 || maxWidth > 16384 || maxHeight > 16384 || slots < 2) {
+		rlawtThrow(env, "invalid frame server size");
+		return;
+	}
+
+	if (!jname) {
+		rlawtThrow(env, "frame server name is null");
+		return;
+	}
+
+	struct FrameServer *fs = calloc(1, sizeof(*fs));
+	if (!fs) {
+		rlawtThrow(env, "unable to allocate frame server");
+		return;
+	}
+
+	const char *name = (*env)->GetStringUTFChars(env, jname, NULL);
+	if (!name) {
+		free(fs);
+		return;
+	}
+	// shm names must start with exactly one slash
+	size_t nameLength = strlen(name);
+	fs->name = malloc(nameLength + 2);
+	if (fs->name) {
+		fs->name[0] = '/';
+		memcpy(fs->name + 1, name[0] == '/' ? name + 1 : name, nameLength + (name[0] == '/' ? 0 : 1));
+	}
+	(*env)->ReleaseStringUTFChars(env, jname, name);
+	if (!fs->name) {
+		free(fs);
+		rlawtThrow(env, "unable to allocate frame server");
+		return;
+	}
+
+	size_t headerSize = (sizeof(FrameServerHeader) + 63) & ~(size_t) 63;
+	size_t slotSize = (sizeof(FrameSlot) + (size_t) maxWidth * maxHeight * 4 + 63) & ~(size_t) 63;
+	fs->mapSize = headerSize + slotSize * slots;
+
+	// never truncate a ring someone still has mapped, which would SIGBUS them
+	int fd = shm_open(fs->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0 && errno == EEXIST && staleRing(fs->name)) {
+		shm_unlink(fs->name);
+		fd = shm_open(fs->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	}
+	if (fd < 0) {
+		rlawtThrow(env, errno == EEXIST ? "frame server name is in use" : "unable to create shared memory");
+		goto freeName;
+	}
+	if (ftruncate(fd, fs->mapSize)) {
+		close(fd);
+		rlawtThrow(env, "unable to size shared memory");
+		goto unlink;
+	}
+	fs->map = mmap(NULL, fs->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (fs->map == MAP_FAILED) {
+		rlawtThrow(env, "unable to map shared memory");
+		goto unlink;
+	}
+
+	FrameServerHeader *h = (FrameServerHeader*) fs->map;
+	h->version = FRAMESERVER_VERSION;
+	h->headerSize = headerSize;
+	h->slotCount = slots;
+	h->slotSize = slotSize;
+	h->maxWidth = maxWidth;
+	h->maxHeight = maxHeight;
+	h->format = FRAMESERVER_FORMAT_BGRA;
+	h->producerPid = getpid();
+	// consumers check the magic last
+	atomic_thread_fence(memory_order_release);
+	memcpy(h->magic, FRAMESERVER_MAGIC, 8);
+	fs->header = h;
+
+	ctx->frameServer = fs;
+	return;
+
+unlink:
+	shm_unlink(fs->name);
+freeName:
+	free(fs->name);
+	free(fs);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_stopFrameServer(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return;
+	}
+
+	rlawtFrameServerFree(ctx);
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rlawt.h"
+#include <stdlib.h>
+
+#ifdef __APPLE__
+#	include <mach/mach_time.h>
+#elif defined(_WIN32)
+#	ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#		define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x2
+#	endif
+#else
+#	include <errno.h>
+#	include <time.h>
+#endif
+
+// how long before the deadline we stop trusting the os to wake us and spin instead
+#ifdef _WIN32
+#	define SPIN_NANOS 1000000ll
+#else
+#	define SPIN_NANOS 200000ll
+#endif
+
+// setFrameLimit may run on any thread, so the interval is the only field it shares with the swap thread
+#ifdef _MSC_VER
+#	define LOAD_INTERVAL(p) InterlockedCompareExchange64((p), 0, 0)
+#	define STORE_INTERVAL(p, v) InterlockedExchange64((p), (v))
+#else
+#	define LOAD_INTERVAL(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#	define STORE_INTERVAL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#endif
+
+#ifdef __APPLE__
+static mach_timebase_info_data_t timebase;
+#endif
+
+#ifdef _WIN32
+static LARGE_INTEGER qpcFrequency;
+#endif
+
+// CLOCK_MONOTONIC or the platform's equivalent, shared by everything which measures time
+int64_t rlawtNanoTime(void) {
+#ifdef __APPLE__
+	if (!timebase.denom) {
+		mach_timebase_info(&timebase);
+	}
+	return (int64_t) (mach_absolute_time() * timebase.numer / timebase.denom);
+#elif defined(_WIN32)
+	if (!qpcFrequency.QuadPart) {
+		QueryPerformanceFrequency(&qpcFrequency);
+	}
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (int64_t) (now.QuadPart / qpcFrequency.QuadPart * 1000000000ll
+		+ now.QuadPart % qpcFrequency.QuadPart * 1000000000ll / qpcFrequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+#endif
+}
+
+static void sleepUntil(AWTContext *ctx, int64_t deadline) {
+#ifdef __APPLE__
+	mach_wait_until((uint64_t) deadline * timebase.denom / timebase.numer);
+#elif defined(_WIN32)
+	// each context has its own timer, since a second SetWaitableTimer would replace the first one's due time
+	if (!ctx->frameTimer) {
+		ctx->frameTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!ctx->frameTimer) {
+			// older than windows 10 1803
+			ctx->frameTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+		}
+	}
+
+	int64_t remaining = deadline - rlawtNanoTime();
+	LARGE_INTEGER due;
+	due.QuadPart = -remaining / 100;
+	if (due.QuadPart < 0) {
+		if (ctx->frameTimer && SetWaitableTimer(ctx->frameTimer, &due, 0, NULL, NULL, false)) {
+			// bounded anyway, so a timer which never fires can only cost one frame
+			WaitForSingleObject(ctx->frameTimer, (DWORD) (remaining / 1000000) + 1);
+		} else {
+			Sleep((DWORD) (remaining / 1000000));
+		}
+	}
+#else
+	struct timespec ts = {
+		.tv_sec = deadline / 1000000000ll,
+		.tv_nsec = deadline % 1000000000ll,
+	};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#endif
+}
+
+void rlawtFrameLimiterWait(AWTContext *ctx) {
+	int64_t interval = LOAD_INTERVAL(&ctx->frameInterval);
+	if (interval != ctx->frameAppliedInterval) {
+		// the limit changed, so start a fresh cadence instead of measuring against the old one
+		ctx->frameAppliedInterval = interval;
+		ctx->frameDeadline = 0;
+	}
+	if (interval <= 0) {
+		return;
+	}
+
+	int64_t now = rlawtNanoTime();
+	int64_t target = ctx->frameDeadline + interval;
+	if (!ctx->frameDeadline || now - target > interval) {
+		// first frame, or so far behind that catching up would just cause a burst of frames
+		if (ctx->frameDeadline) {
+			ctx->limiterLate++;
+		}
+		ctx->frameDeadline = now;
+		return;
+	}
+
+	if (now > target) {
+		// a little late, so keep the cadence and let the next frame make it up
+		ctx->limiterLate++;
+		ctx->frameDeadline = target;
+		return;
+	}
+
+	if (target - now > SPIN_NANOS) {
+		sleepUntil(ctx, target - SPIN_NANOS);
+	}
+	while ((now = rlawtNanoTime()) < target);
+
+	int64_t error = now - target;
+	ctx->limiterFrames++;
+	ctx->limiterErrorSum += error;
+	if (error > ctx->limiterErrorMax) {
+		ctx->limiterErrorMax = error;
+	}
+	ctx->frameDeadline = target;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setFrameLimit(JNIEnv *env, jobject self, jint fps) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx) {
+		return;
+	}
+
+	STORE_INTERVAL(&ctx->frameInterval, fps > 0 ? 1000000000ll / fps : 0);
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getFrameLimiterStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx) {
+		return NULL;
+	}
+
+	jlong stats[] = {
+		ctx->limiterFrames,
+		ctx->limiterFrames ? ctx->limiterErrorSum / (int64_t) ctx->limiterFrames : 0,
+		ctx->limiterErrorMax,
+		ctx->limiterLate,
+	};
+
+	jlongArray array = (*env)->NewLongArray(env, sizeof(stats) / sizeof(stats[0]));
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, sizeof(stats) / sizeof(stats[0]), stats);
+	}
+	return array;
+}
@@ -204,7 +204,7 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createGLContext(JNIEnv
 		goto freeDSI;
 	}
 
-	err = CGLCreateContext(pxFmt, NULL, &ctx->context);
+	err = CGLCreateContext(pxFmt, ctx->share ? ctx->share->context : NULL, &ctx->context);
 	CGLReleasePixelFormat(pxFmt);
 	if (!ctx->context || err != kCGLNoError) {
 		rlawtThrowCGLError(env, "unable to create context", err);
@@ -299,6 +299,8 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_swapBuffers(JNIEnv *en
 		return;
 	}
 
+	rlawtFrameLimiterWait(ctx);
+
 	glFlush();
 	RLLayer *rlLayer = (RLLayer*) ctx->layer;
 	rlLayer->newScale = ctx->bufferScale[ctx->back];
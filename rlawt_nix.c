@@ -27,7 +27,14 @@
 
 #include "rlawt.h"
 #include <jawt_md.h>
+#include <X11/Xlib-xcb.h>
+#include <X11/extensions/Xcomposite.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 static XErrorEvent lastError = {0};
 static int rlawtXErrorHandler(Display *display, XErrorEvent *event) {
@@ -61,12 +68,755 @@ static bool makeCurrent(JNIEnv *env, Display *dpy, GLXDrawable drawable, GLXCont
 	return true;
 }
 
+// EGL and GLX track their current contexts separately, so each reports none
+// while the other's is current
+bool rlawtIsCurrent(AWTContext *ctx) {
+	if (ctx->eglContext) {
+		return eglGetCurrentContext() == ctx->eglContext;
+	}
+	return glXGetCurrentContext() == ctx->context;
+}
+
+// Current on this thread and bound to our drawable, which is everything
+// makeCurrent would do. Both APIs keep this in thread local storage, so it
+// also sees binds made by mirrors or by other libraries.
+bool rlawtIsBound(AWTContext *ctx) {
+	if (ctx->eglContext) {
+		return eglGetCurrentContext() == ctx->eglContext && eglGetCurrentSurface(EGL_DRAW) == ctx->eglSurface;
+	}
+	return glXGetCurrentContext() == ctx->context && glXGetCurrentDrawable() == ctx->drawable;
+}
+
+bool rlawtContextCurrent(JNIEnv *env, AWTContext *ctx) {
+	if (!rlawtIsCurrent(ctx)) {
+		rlawtThrow(env, "context is not current");
+		return false;
+	}
+	return true;
+}
+
+bool rlawtHasGLExtension(const char *name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char *ext = (const char*) glGetStringi(GL_EXTENSIONS, i);
+		if (ext && !strcmp(ext, name)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Whole token match in a space separated extension string, which may be null
+// if the query failed. A plain strstr would also match any longer name.
+bool rlawtHasExtension(const char *extensions, const char *name) {
+	size_t len = strlen(name);
+	for (const char *p = extensions; p && (p = strstr(p, name)); p += len) {
+		if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool rlawtWriteAll(int fd, const void *data, size_t len) {
+	const uint8_t *p = data;
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+#define DRAWABLE_EVENT_MASK (VisibilityChangeMask | StructureNotifyMask | ExposureMask)
+
+// Window queries go through XCB so independent requests share a round trip
+// and their errors come back with their replies instead of through the
+// global Xlib error handler
+typedef struct {
+	xcb_void_cookie_t select;
+	xcb_get_window_attributes_cookie_t attributes;
+	xcb_get_geometry_cookie_t geometry;
+	xcb_query_tree_cookie_t tree;
+} WindowQueries;
+
+// Selects events on the drawable, then asks for its state and parent. The
+// attributes are only requested after the select, so no map change can be
+// missed in between.
+static void queryWindow(AWTContext *ctx, WindowQueries *q) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	uint32_t mask = DRAWABLE_EVENT_MASK;
+	q->select = xcb_change_window_attributes_checked(conn, ctx->drawable, XCB_CW_EVENT_MASK, &mask);
+	q->attributes = xcb_get_window_attributes(conn, ctx->drawable);
+	q->geometry = xcb_get_geometry(conn, ctx->drawable);
+	q->tree = xcb_query_tree(conn, ctx->drawable);
+}
+
+static void discardWindowQueries(AWTContext *ctx, WindowQueries *q) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	xcb_discard_reply(conn, q->select.sequence);
+	xcb_discard_reply(conn, q->attributes.sequence);
+	xcb_discard_reply(conn, q->geometry.sequence);
+	xcb_discard_reply(conn, q->tree.sequence);
+}
+
+static void readViewable(AWTContext *ctx, xcb_get_window_attributes_cookie_t attributes, xcb_get_geometry_cookie_t geometry) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	xcb_get_window_attributes_reply_t *attrs = xcb_get_window_attributes_reply(conn, attributes, NULL);
+	xcb_get_geometry_reply_t *geom = xcb_get_geometry_reply(conn, geometry, NULL);
+	ctx->viewable = attrs && geom && attrs->map_state == XCB_MAP_STATE_VIEWABLE;
+	if (attrs && geom) {
+		ctx->width = geom->width;
+		ctx->height = geom->height;
+	}
+	free(attrs);
+	free(geom);
+}
+
+// Every ancestor up to the root has its map state tracked, since minimizing
+// unmaps the top level window without generating any event on the drawable.
+// Walking the tree takes a round trip per level, so each ancestor's select
+// is sent along with the query for the next level.
+static void trackWindow(AWTContext *ctx, WindowQueries *q) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	xcb_void_cookie_t selects[1 + sizeof(ctx->ancestors) / sizeof(ctx->ancestors[0])];
+	int numSelects = 0;
+	selects[numSelects++] = q->select;
+
+	ctx->numAncestors = 0;
+	xcb_query_tree_cookie_t treeCookie = q->tree;
+	for (;;) {
+		xcb_query_tree_reply_t *tree = xcb_query_tree_reply(conn, treeCookie, NULL);
+		if (!tree) {
+			break;
+		}
+		xcb_window_t root = tree->root;
+		xcb_window_t parent = tree->parent;
+		free(tree);
+		if (parent == root || parent == XCB_NONE) {
+			break;
+		}
+
+		uint32_t mask = StructureNotifyMask;
+		selects[numSelects++] = xcb_change_window_attributes_checked(conn, parent, XCB_CW_EVENT_MASK, &mask);
+		ctx->ancestors[ctx->numAncestors++] = parent;
+		if (ctx->numAncestors >= (int) (sizeof(ctx->ancestors) / sizeof(ctx->ancestors[0]))) {
+			break;
+		}
+		treeCookie = xcb_query_tree(conn, parent);
+	}
+
+	readViewable(ctx, q->attributes, q->geometry);
+
+	// windows can be destroyed under us at any time, which only means there is nothing left to track
+	for (int i = 0; i < numSelects; i++) {
+		free(xcb_request_check(conn, selects[i]));
+	}
+}
+
+static void updateViewable(AWTContext *ctx) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	xcb_get_window_attributes_cookie_t attributes = xcb_get_window_attributes(conn, ctx->drawable);
+	xcb_get_geometry_cookie_t geometry = xcb_get_geometry(conn, ctx->drawable);
+	readViewable(ctx, attributes, geometry);
+}
+
+static xcb_atom_t atomReply(xcb_connection_t *conn, xcb_intern_atom_cookie_t cookie) {
+	xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(conn, cookie, NULL);
+	xcb_atom_t atom = reply ? reply->atom : XCB_ATOM_NONE;
+	free(reply);
+	return atom;
+}
+
+// Window managers read _NET_WM_BYPASS_COMPOSITOR from the client's top level
+// window, which is the ancestor carrying WM_STATE. Without a window manager
+// nothing carries it, and the outermost ancestor is the closest thing.
+static xcb_window_t clientTopLevel(AWTContext *ctx, xcb_atom_t wmState) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	xcb_get_property_cookie_t cookies[sizeof(ctx->ancestors) / sizeof(ctx->ancestors[0])];
+	for (int i = 0; i < ctx->numAncestors; i++) {
+		cookies[i] = xcb_get_property(conn, false, ctx->ancestors[i], wmState, XCB_ATOM_ANY, 0, 0);
+	}
+
+	xcb_window_t top = ctx->numAncestors > 0 ? ctx->ancestors[ctx->numAncestors - 1] : ctx->drawable;
+	bool found = false;
+	for (int i = 0; i < ctx->numAncestors; i++) {
+		xcb_get_property_reply_t *reply = xcb_get_property_reply(conn, cookies[i], NULL);
+		if (!found && reply && reply->type != XCB_ATOM_NONE) {
+			top = ctx->ancestors[i];
+			found = true;
+		}
+		free(reply);
+	}
+	return top;
+}
+
+// Moves the bypass hint to wherever it belongs now, or removes it. Called
+// again whenever the window is reparented, since that can change which
+// window the window manager is looking at.
+static void applyBypassCompositor(AWTContext *ctx) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	static const char bypassName[] = "_NET_WM_BYPASS_COMPOSITOR";
+	static const char wmStateName[] = "WM_STATE";
+	xcb_intern_atom_cookie_t bypassCookie = xcb_intern_atom(conn, false, sizeof(bypassName) - 1, bypassName);
+	xcb_intern_atom_cookie_t wmStateCookie = xcb_intern_atom(conn, false, sizeof(wmStateName) - 1, wmStateName);
+	xcb_atom_t bypass = atomReply(conn, bypassCookie);
+	xcb_atom_t wmState = atomReply(conn, wmStateCookie);
+	if (bypass == XCB_ATOM_NONE) {
+		return;
+	}
+
+	xcb_window_t top = ctx->bypassCompositor ? clientTopLevel(ctx, wmState) : None;
+	// either window may already be gone, and any error is dropped with the reply
+	if (ctx->bypassWindow && ctx->bypassWindow != top) {
+		xcb_discard_reply(conn, xcb_delete_property_checked(conn, ctx->bypassWindow, bypass).sequence);
+	}
+	if (top) {
+		uint32_t value = 1;
+		xcb_discard_reply(conn, xcb_change_property_checked(conn, XCB_PROP_MODE_REPLACE, top, bypass, XCB_ATOM_CARDINAL, 32, 1, &value).sequence);
+	}
+	ctx->bypassWindow = top;
+	xcb_flush(conn);
+}
+
+static Bool isVisibilityEvent(Display *dpy, XEvent *ev, XPointer arg) {
+	AWTContext *ctx = (AWTContext*) arg;
+	if (ev->xany.window == ctx->drawable) {
+		return true;
+	}
+	for (int i = 0; i < ctx->numAncestors; i++) {
+		if (ev->xany.window == ctx->ancestors[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void rlawtProcessEvents(AWTContext *ctx) {
+	bool mapChanged = false;
+	bool reparented = false;
+
+	XEvent ev;
+	while (XCheckIfEvent(ctx->dpy, &ev, isVisibilityEvent, (XPointer) ctx)) {
+		switch (ev.type) {
+		case VisibilityNotify:
+			ctx->visibility = ev.xvisibility.state;
+			break;
+		case Expose:
+			// something is being shown, which compositors may never tell us through VisibilityNotify
+			if (ctx->visibility == VisibilityFullyObscured) {
+				ctx->visibility = VisibilityPartiallyObscured;
+			}
+			break;
+		case ConfigureNotify:
+			if (ev.xconfigure.window == ctx->drawable) {
+				ctx->width = ev.xconfigure.width;
+				ctx->height = ev.xconfigure.height;
+			}
+			break;
+		case MapNotify:
+		case UnmapNotify:
+			mapChanged = true;
+			break;
+		case ReparentNotify:
+			reparented = true;
+			mapChanged = true;
+			break;
+		}
+	}
+
+	if (reparented) {
+		xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+		uint32_t mask = NoEventMask;
+		for (int i = 0; i < ctx->numAncestors; i++) {
+			// old ancestors may be gone, and any error is dropped with the reply
+			xcb_discard_reply(conn, xcb_change_window_attributes_checked(conn, ctx->ancestors[i], XCB_CW_EVENT_MASK, &mask).sequence);
+		}
+		WindowQueries q;
+		queryWindow(ctx, &q);
+		trackWindow(ctx, &q);
+		if (ctx->bypassCompositor) {
+			applyBypassCompositor(ctx);
+		}
+	} else if (mapChanged) {
+		updateViewable(ctx);
+	}
+}
+
+static bool shouldRender(AWTContext *ctx) {
+	return ctx->viewable && ctx->visibility != VisibilityFullyObscured;
+}
+
+// Released contexts are kept alive along with their display connection so a
+// new AWTContext with the same pixel format can adopt them and keep all of
+// their GL objects
+typedef struct {
+	Display *dpy;
+	GLXContext context;
+	GLXFBConfig fbConfig;
+	VisualID visualID;
+	uint64_t shareGroup;
+	bool doubleBuffered;
+	int alphaDepth;
+	int depthDepth;
+	int stencilDepth;
+	int multisamples;
+} PooledContext;
+
+// Contexts which share objects also have to share a display connection, so
+// displays handed to more than one context are reference counted. Displays
+// which are not in this table have a single owner.
+typedef struct {
+	Display *dpy;
+	int refs;
+} DisplayRef;
+
+static pthread_mutex_t displayLock = PTHREAD_MUTEX_INITIALIZER;
+static DisplayRef displayRefs[16];
+
+static bool retainDisplay(Display *dpy) {
+	bool retained = false;
+	pthread_mutex_lock(&displayLock);
+	DisplayRef *slot = NULL;
+	for (int i = 0; i < (int) (sizeof(displayRefs) / sizeof(displayRefs[0])); i++) {
+		if (displayRefs[i].dpy == dpy) {
+			displayRefs[i].refs++;
+			retained = true;
+			break;
+		}
+		if (!displayRefs[i].dpy && !slot) {
+			slot = &displayRefs[i];
+		}
+	}
+	if (!retained && slot) {
+		slot->dpy = dpy;
+		slot->refs = 2;
+		retained = true;
+	}
+	pthread_mutex_unlock(&displayLock);
+	return retained;
+}
+
+static void releaseDisplay(Display *dpy) {
+	pthread_mutex_lock(&displayLock);
+	for (int i = 0; i < (int) (sizeof(displayRefs) / sizeof(displayRefs[0])); i++) {
+		if (displayRefs[i].dpy == dpy) {
+			if (--displayRefs[i].refs > 0) {
+				pthread_mutex_unlock(&displayLock);
+				return;
+			}
+			displayRefs[i].dpy = NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&displayLock);
+
+	XCloseDisplay(dpy);
+}
+
+static uint64_t nextShareGroup = 0;
+
+#define MAX_POOL_SIZE 8
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static PooledContext pool[MAX_POOL_SIZE];
+static int poolLength = 0;
+static int poolCapacity = 0;
+
+static void destroyPooledContext(PooledContext *pooled) {
+	glXDestroyContext(pooled->dpy, pooled->context);
+	releaseDisplay(pooled->dpy);
+}
+
+static bool adoptPooledContext(AWTContext *ctx, const char *displayName) {
+	if (ctx->debugContext) {
+		return false;
+	}
+
+	pthread_mutex_lock(&poolLock);
+	PooledContext pooled = {0};
+	for (int i = poolLength - 1; i >= 0; i--) {
+		PooledContext *p = &pool[i];
+		if (p->visualID == ctx->visualID
+			&& p->alphaDepth == ctx->alphaDepth
+			&& p->depthDepth == ctx->depthDepth
+			&& p->stencilDepth == ctx->stencilDepth
+			&& p->multisamples == ctx->multisamples
+			&& !strcmp(XDisplayString(p->dpy), displayName)) {
+			pooled = *p;
+			memmove(p, p + 1, (poolLength - i - 1) * sizeof(*p));
+			poolLength--;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&poolLock);
+
+	if (!pooled.dpy) {
+		return false;
+	}
+
+	if (!glXMakeCurrent(pooled.dpy, ctx->drawable, pooled.context)) {
+		destroyPooledContext(&pooled);
+		return false;
+	}
+
+	ctx->dpy = pooled.dpy;
+	ctx->context = pooled.context;
+	ctx->fbConfig = pooled.fbConfig;
+	ctx->shareGroup = pooled.shareGroup;
+	ctx->doubleBuffered = pooled.doubleBuffered;
+	ctx->contextReused = true;
+	return true;
+}
+
+// Makes a context which is going to be pooled current on this thread, so the
+// objects rlawt created in it can be deleted first. A context which is current
+// on another thread can't be, and is never pooled.
+static bool bindForPool(JNIEnv *env, AWTContext *ctx) {
+	// a debug context's callback points into this AWTContext
+	if (ctx->eglContext || ctx->debugContext) {
+		return false;
+	}
+
+	pthread_mutex_lock(&poolLock);
+	bool room = poolLength < poolCapacity;
+	pthread_mutex_unlock(&poolLock);
+	if (!room) {
+		return false;
+	}
+
+	if (rlawtIsCurrent(ctx)) {
+		return true;
+	}
+
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+	lastError.display = 0;
+	// BadAccess if another thread has it current, and the canvas may already be gone
+	Bool bound = glXMakeCurrent(ctx->dpy, ctx->drawable, ctx->context);
+	XSync(ctx->dpy, false);
+	bool failed = !bound || lastError.display != 0;
+	lastError.display = 0;
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+	return !failed;
+}
+
+static void releaseToPool(JNIEnv *env, AWTContext *ctx) {
+	glXMakeCurrent(ctx->dpy, None, NULL);
+
+	// stop listening to windows we no longer own, which may already be gone
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+	XSelectInput(ctx->dpy, ctx->drawable, NoEventMask);
+	for (int i = 0; i < ctx->numAncestors; i++) {
+		XSelectInput(ctx->dpy, ctx->ancestors[i], NoEventMask);
+	}
+	XSync(ctx->dpy, false);
+	XEvent ev;
+	while (XCheckIfEvent(ctx->dpy, &ev, isVisibilityEvent, (XPointer) ctx));
+	lastError.display = 0;
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+
+	PooledContext pooled = {
+		.dpy = ctx->dpy,
+		.context = ctx->context,
+		.fbConfig = ctx->fbConfig,
+		.visualID = ctx->visualID,
+		.shareGroup = ctx->shareGroup,
+		.doubleBuffered = ctx->doubleBuffered,
+		.alphaDepth = ctx->alphaDepth,
+		.depthDepth = ctx->depthDepth,
+		.stencilDepth = ctx->stencilDepth,
+		.multisamples = ctx->multisamples,
+	};
+
+	pthread_mutex_lock(&poolLock);
+	bool room = poolLength < poolCapacity;
+	if (room) {
+		pool[poolLength++] = pooled;
+	}
+	pthread_mutex_unlock(&poolLock);
+
+	if (!room) {
+		destroyPooledContext(&pooled);
+	}
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setContextPoolSize(JNIEnv *env, jclass clazz, jint size) {
+	if (size < 0) {
+		size = 0;
+	} else if (size > MAX_POOL_SIZE) {
+		size = MAX_POOL_SIZE;
+	}
+
+	PooledContext evicted[MAX_POOL_SIZE];
+	int numEvicted = 0;
+
+	pthread_mutex_lock(&poolLock);
+	poolCapacity = size;
+	if (poolLength > size) {
+		// oldest first
+		numEvicted = poolLength - size;
+		memcpy(evicted, pool, numEvicted * sizeof(*pool));
+		memmove(pool, pool + numEvicted, size * sizeof(*pool));
+		poolLength = size;
+	}
+	pthread_mutex_unlock(&poolLock);
+
+	for (int i = 0; i < numEvicted; i++) {
+		destroyPooledContext(&evicted[i]);
+	}
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_isContextReused(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return false;
+	}
+
+	return ctx->contextReused;
+}
+
+typedef struct {
+	GLXFBConfig config;
+	int score;
+	int order;
+} ScoredFBConfig;
+
+static int fbConfigAttrib(Display *dpy, GLXFBConfig config, int attrib) {
+	int value = 0;
+	glXGetFBConfigAttrib(dpy, config, attrib, &value);
+	return value;
+}
+
+static int excess(int value, int requested) {
+	return value > requested ? value - requested : 0;
+}
+
+// Higher is better. Double buffering outweighs everything else, then configs
+// the driver flags as slow or non-conformant are pushed down, then the JAWT
+// visual is preferred. The rest only breaks ties by penalizing buffers and
+// samples beyond what was asked for, since they cost bandwidth for nothing.
+static int scoreFBConfig(AWTContext *ctx, GLXFBConfig config) {
+	Display *dpy = ctx->dpy;
+	int score = 0;
+
+	if (fbConfigAttrib(dpy, config, GLX_DOUBLEBUFFER)) {
+		score += 100000;
+	}
+	switch (fbConfigAttrib(dpy, config, GLX_CONFIG_CAVEAT)) {
+	case GLX_SLOW_CONFIG:
+		score -= 50000;
+		break;
+	case GLX_NON_CONFORMANT_CONFIG:
+		score -= 20000;
+		break;
+	}
+	// X11 doesn't seem to care if you use a matching visual, but we try to anyway
+	if ((VisualID) fbConfigAttrib(dpy, config, GLX_VISUAL_ID) == ctx->visualID) {
+		score += 10000;
+	}
+
+	score -= 200 * excess(fbConfigAttrib(dpy, config, GLX_SAMPLES), ctx->multisamples);
+	score -= 100 * fbConfigAttrib(dpy, config, GLX_AUX_BUFFERS);
+	score -= 10 * (fbConfigAttrib(dpy, config, GLX_ACCUM_RED_SIZE)
+		+ fbConfigAttrib(dpy, config, GLX_ACCUM_GREEN_SIZE)
+		+ fbConfigAttrib(dpy, config, GLX_ACCUM_BLUE_SIZE)
+		+ fbConfigAttrib(dpy, config, GLX_ACCUM_ALPHA_SIZE));
+	score -= 20 * (excess(fbConfigAttrib(dpy, config, GLX_RED_SIZE), 8)
+		+ excess(fbConfigAttrib(dpy, config, GLX_GREEN_SIZE), 8)
+		+ excess(fbConfigAttrib(dpy, config, GLX_BLUE_SIZE), 8));
+	score -= 10 * (excess(fbConfigAttrib(dpy, config, GLX_ALPHA_SIZE), ctx->alphaDepth)
+		+ excess(fbConfigAttrib(dpy, config, GLX_DEPTH_SIZE), ctx->depthDepth)
+		+ excess(fbConfigAttrib(dpy, config, GLX_STENCIL_SIZE), ctx->stencilDepth));
+	return score;
+}
+
+static int compareScoredFBConfigs(const void *a, const void *b) {
+	const ScoredFBConfig *x = a, *y = b;
+	if (x->score != y->score) {
+		return x->score > y->score ? -1 : 1;
+	}
+	// keep the server's own ordering between equals
+	return x->order - y->order;
+}
+
+// Returns every config which satisfies the requested pixel format, best
+// first. The caller frees the list.
+static ScoredFBConfig *rankFBConfigs(AWTContext *ctx, int screen, int *count) {
+	int attribs[] = {
+		GLX_RENDER_TYPE, GLX_RGBA_BIT,
+		GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT, // JAWT never hands out a pixmap
+		GLX_X_VISUAL_TYPE, GLX_TRUE_COLOR,
+		GLX_X_RENDERABLE, true,
+		GLX_RED_SIZE, 8,
+		GLX_GREEN_SIZE, 8,
+		GLX_BLUE_SIZE, 8,
+		GLX_ALPHA_SIZE, ctx->alphaDepth,
+		GLX_DEPTH_SIZE, ctx->depthDepth,
+		GLX_STENCIL_SIZE, ctx->stencilDepth,
+		GLX_SAMPLE_BUFFERS, ctx->multisamples > 0,
+		GLX_SAMPLES, ctx->multisamples,
+		GLX_DOUBLEBUFFER, GLX_DONT_CARE,
+		None
+	};
+
+	*count = 0;
+	int nConfigs = 0;
+	GLXFBConfig *fbConfigs = glXChooseFBConfig(ctx->dpy, screen, attribs, &nConfigs);
+	if (!fbConfigs) {
+		return NULL;
+	}
+
+	ScoredFBConfig *ranked = nConfigs > 0 ? malloc(nConfigs * sizeof(*ranked)) : NULL;
+	if (ranked) {
+		for (int i = 0; i < nConfigs; i++) {
+			ranked[i].config = fbConfigs[i];
+			ranked[i].score = scoreFBConfig(ctx, fbConfigs[i]);
+			ranked[i].order = i;
+		}
+		qsort(ranked, nConfigs, sizeof(*ranked), compareScoredFBConfigs);
+		*count = nConfigs;
+	}
+	XFree(fbConfigs);
+	return ranked;
+}
+
+static GLXFBConfig chooseFBConfig(AWTContext *ctx, int screen) {
+	int count;
+	ScoredFBConfig *ranked = rankFBConfigs(ctx, screen, &count);
+	if (!ranked) {
+		return NULL;
+	}
+
+	GLXFBConfig fbConfig = ranked[0].config;
+	ctx->doubleBuffered = fbConfigAttrib(ctx->dpy, fbConfig, GLX_DOUBLEBUFFER);
+	free(ranked);
+	return fbConfig;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_net_runelite_rlawt_AWTContext_getFBConfigCandidates(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	if (ctx->eglContext) {
+		rlawtThrow(env, "not supported with dma-buf export");
+		return NULL;
+	}
+
+	jclass stringClass = (*env)->FindClass(env, "java/lang/String");
+	if (!stringClass) {
+		return NULL;
+	}
+
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+
+	int screen = fbConfigAttrib(ctx->dpy, ctx->fbConfig, GLX_SCREEN);
+	int count;
+	ScoredFBConfig *ranked = rankFBConfigs(ctx, screen, &count);
+	jobjectArray array = (*env)->NewObjectArray(env, count, stringClass, NULL);
+	for (int i = 0; array && i < count; i++) {
+		Display *dpy = ctx->dpy;
+		GLXFBConfig c = ranked[i].config;
+		int caveat = fbConfigAttrib(dpy, c, GLX_CONFIG_CAVEAT);
+		char buf[256];
+		snprintf(buf, sizeof(buf),
+			"%s0x%x score=%d visual=0x%x double=%d rgba=%d/%d/%d/%d depth=%d stencil=%d samples=%d accum=%d/%d/%d/%d aux=%d caveat=%s",
+			c == ctx->fbConfig ? "*" : "",
+			fbConfigAttrib(dpy, c, GLX_FBCONFIG_ID),
+			ranked[i].score,
+			fbConfigAttrib(dpy, c, GLX_VISUAL_ID),
+			fbConfigAttrib(dpy, c, GLX_DOUBLEBUFFER),
+			fbConfigAttrib(dpy, c, GLX_RED_SIZE),
+			fbConfigAttrib(dpy, c, GLX_GREEN_SIZE),
+			fbConfigAttrib(dpy, c, GLX_BLUE_SIZE),
+			fbConfigAttrib(dpy, c, GLX_ALPHA_SIZE),
+			fbConfigAttrib(dpy, c, GLX_DEPTH_SIZE),
+			fbConfigAttrib(dpy, c, GLX_STENCIL_SIZE),
+			fbConfigAttrib(dpy, c, GLX_SAMPLES),
+			fbConfigAttrib(dpy, c, GLX_ACCUM_RED_SIZE),
+			fbConfigAttrib(dpy, c, GLX_ACCUM_GREEN_SIZE),
+			fbConfigAttrib(dpy, c, GLX_ACCUM_BLUE_SIZE),
+			fbConfigAttrib(dpy, c, GLX_ACCUM_ALPHA_SIZE),
+			fbConfigAttrib(dpy, c, GLX_AUX_BUFFERS),
+			caveat == GLX_SLOW_CONFIG ? "slow" : caveat == GLX_NON_CONFORMANT_CONFIG ? "non-conformant" : "none");
+		jstring str = (*env)->NewStringUTF(env, buf);
+		if (!str) {
+			array = NULL;
+			break;
+		}
+		(*env)->SetObjectArrayElement(env, array, i, str);
+		(*env)->DeleteLocalRef(env, str);
+	}
+	free(ranked);
+
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+	return array;
+}
+
+static GLXContext createContext(AWTContext *ctx, GLXFBConfig fbConfig, GLXContext share) {
+	const char *extensions = glXQueryExtensionsString(ctx->dpy, DefaultScreen(ctx->dpy));
+
+	PFNGLXCREATECONTEXTATTRIBSARBPROC glXCreateContextAttribsARB = NULL;
+	if (rlawtHasExtension(extensions, "GLX_ARB_create_context")) {
+		glXCreateContextAttribsARB = (PFNGLXCREATECONTEXTATTRIBSARBPROC) glXGetProcAddressARB("glXCreateContextAttribsARB");
+	}
+
+	if (glXCreateContextAttribsARB) {
+		int attribs[] = {
+			GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+			GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+			GLX_CONTEXT_FLAGS_ARB, ctx->debugContext ? GLX_CONTEXT_DEBUG_BIT_ARB : 0,
+			0
+		};
+		return glXCreateContextAttribsARB(ctx->dpy, fbConfig, share, true, attribs);
+	} else {
+		return glXCreateNewContext(ctx->dpy, fbConfig, GLX_RGBA_TYPE, share, true);
+	}
+}
+
+static void loadSwapExtensions(AWTContext *ctx) {
+	const char *extensions = glXQueryExtensionsString(ctx->dpy, DefaultScreen(ctx->dpy));
+
+	if (rlawtHasExtension(extensions, "GLX_EXT_swap_control")) {
+		ctx->glXSwapIntervalEXT = (PFNGLXSWAPINTERVALEXTPROC) glXGetProcAddress("glXSwapIntervalEXT");
+		ctx->glxSwapControlTear = rlawtHasExtension(extensions, "GLX_EXT_swap_control_tear");
+	} else if (rlawtHasExtension(extensions, "GLX_SGI_swap_control")) {
+		ctx->glXSwapIntervalSGI = (PFNGLXSWAPINTERVALSGIPROC) glXGetProcAddress("glXSwapIntervalSGI");
+	}
+
+	if (rlawtHasExtension(extensions, "GLX_OML_sync_control")) {
+		ctx->glXGetSyncValuesOML = (PFNGLXGETSYNCVALUESOMLPROC) glXGetProcAddress((const GLubyte*) "glXGetSyncValuesOML");
+		PFNGLXGETMSCRATEOMLPROC glXGetMscRateOML = (PFNGLXGETMSCRATEOMLPROC) glXGetProcAddress((const GLubyte*) "glXGetMscRateOML");
+		int32_t numerator, denominator;
+		if (glXGetMscRateOML && glXGetMscRateOML(ctx->dpy, ctx->drawable, &numerator, &denominator) && numerator > 0) {
+			ctx->refreshPeriod = 1000000000ll * denominator / numerator;
+		}
+	}
+}
+
 JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createGLContext(JNIEnv *env, jobject self) {
 	AWTContext *ctx = rlawtGetContext(env, self);
 	if (!ctx || !rlawtContextState(env, ctx, false)) {
 		return;
 	}
 
+	WindowQueries windowQueries;
+	bool windowQueried = false;
+	bool checkGLX = false;
+
 	ctx->awt.Lock(env);
 	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
 
@@ -89,89 +839,87 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createGLContext(JNIEnv
 	}
 
 	ctx->drawable = dspi->drawable;
+	ctx->visualID = dspi->visualID;
 
 	const char *displayName = XDisplayString(dspi->display);
-	ctx->dpy = XOpenDisplay(displayName);
-	if (!ctx->dpy) {
-		rlawtThrow(env, "unable to open display copy");
+	// an EGL context has neither a GLX context to share with nor a display connection to spare
+	if (ctx->share && ctx->share->eglContext) {
+		rlawtThrow(env, "shared contexts are not supported with dma-buf export");
 		goto freeDSI;
 	}
-
-	if (!glXQueryExtension(ctx->dpy, NULL, NULL)) {
-		rlawtThrow(env, "glx is not supported");
-		goto freeDisplay;
-	}
-
-	int screen = DefaultScreen(ctx->dpy);
-
-	GLXFBConfig fbConfig = NULL;
-	for (int db = 0; db < 2; db++) {
-		ctx->doubleBuffered = db == 0;
-
-		int attribs[] = {
-			GLX_RENDER_TYPE, GLX_RGBA_BIT,
-			GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT, // JAWT never hands out a pixmap
-			GLX_X_VISUAL_TYPE, GLX_TRUE_COLOR,
-			GLX_X_RENDERABLE, true,
-			GLX_RED_SIZE, 8,
-			GLX_GREEN_SIZE, 8,
-			GLX_BLUE_SIZE, 8,
-			GLX_ALPHA_SIZE, ctx->alphaDepth,
-			GLX_DEPTH_SIZE, ctx->depthDepth,
-			GLX_STENCIL_SIZE, ctx->stencilDepth,
-			GLX_SAMPLE_BUFFERS, ctx->multisamples > 0,
-			GLX_SAMPLES, ctx->multisamples,
-			GLX_DOUBLEBUFFER, ctx->doubleBuffered,
-			None
-		};
-
-		int nConfigs;
-		GLXFBConfig *fbConfigs = glXChooseFBConfig(ctx->dpy, screen, attribs, &nConfigs);
-		if (!fbConfigs) {
-			continue;
+	if (ctx->dmaBufImages > 0) {
+		if (ctx->share) {
+			rlawtThrow(env, "shared contexts are not supported with dma-buf export");
+			goto freeDSI;
 		}
-
-		// X11 doesn't seem to care if you use a matching visual, but we try to anyway
-		for (int i = 0; i < nConfigs; i++) {
-			int	fbVid = -1;
-			glXGetFBConfigAttrib(ctx->dpy, fbConfigs[i], GLX_VISUAL_ID, &fbVid);
-			if (fbVid == dspi->visualID) {
-				fbConfig = fbConfigs[i];
-				break;
-			}
+		ctx->dpy = XOpenDisplay(displayName);
+		if (!ctx->dpy) {
+			rlawtThrow(env, "unable to open display copy");
+			goto freeDSI;
+		}
+		if (!rlawtEGLCreate(env, ctx)) {
+			goto freeDisplay;
+		}
+		goto contextReady;
+	} else if (ctx->share) {
+		// objects can only be shared between contexts on the same display connection
+		if (strcmp(XDisplayString(ctx->share->dpy), displayName)) {
+			rlawtThrow(env, "shared context is on a different display");
+			goto freeDSI;
+		}
+		if (!retainDisplay(ctx->share->dpy)) {
+			rlawtThrow(env, "too many shared displays");
+			goto freeDSI;
 		}
+		ctx->dpy = ctx->share->dpy;
+	} else if (adoptPooledContext(ctx, displayName)) {
+		goto contextReady;
+	} else {
+		ctx->dpy = XOpenDisplay(displayName);
+		if (!ctx->dpy) {
+			rlawtThrow(env, "unable to open display copy");
+			goto freeDSI;
+		}
+		checkGLX = true;
+	}
 
-		if (fbConfig) {
-			XFree(fbConfigs);
-			break;
-		} else {
-			fbConfig = fbConfigs[0];
-			XFree(fbConfigs);
+	// the window's state and first tree level arrive in the same round trip as the glx check
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	xcb_query_extension_cookie_t glxCookie;
+	if (checkGLX) {
+		glxCookie = xcb_query_extension(conn, 3, "GLX");
+	}
+	queryWindow(ctx, &windowQueries);
+	windowQueried = true;
+	if (checkGLX) {
+		xcb_query_extension_reply_t *glx = xcb_query_extension_reply(conn, glxCookie, NULL);
+		bool present = glx && glx->present;
+		free(glx);
+		if (!present) {
+			rlawtThrow(env, "glx is not supported");
+			goto freeDisplay;
 		}
 	}
+
+	int screen = DefaultScreen(ctx->dpy);
+
+	GLXFBConfig fbConfig = chooseFBConfig(ctx, screen);
 	if (!fbConfig) {
 		rlawtThrow(env, "unable to find a fb config");
 		goto freeDisplay;
 	}
 
-	const char *extensions = glXQueryExtensionsString(ctx->dpy, screen);
-
-	PFNGLXCREATECONTEXTATTRIBSARBPROC glXCreateContextAttribsARB = NULL;
-	if (strstr(extensions, "GLX_ARB_create_context")) {
-		glXCreateContextAttribsARB = (PFNGLXCREATECONTEXTATTRIBSARBPROC) glXGetProcAddressARB("glXCreateContextAttribsARB");
-	}
-
-	if (glXCreateContextAttribsARB) {
-		int attribs[] = {
-			GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
-			GLX_CONTEXT_MINOR_VERSION_ARB, 3,
-			0
-		};
-		ctx->context = glXCreateContextAttribsARB(ctx->dpy, fbConfig, NULL, true, attribs);
-	} else {
-		ctx->context = glXCreateNewContext(ctx->dpy, fbConfig, GLX_RGBA_TYPE, NULL, true);
+	if (ctx->share) {
+		int shareScreen = -1, configScreen = -2;
+		glXGetFBConfigAttrib(ctx->dpy, ctx->share->fbConfig, GLX_SCREEN, &shareScreen);
+		glXGetFBConfigAttrib(ctx->dpy, fbConfig, GLX_SCREEN, &configScreen);
+		if (shareScreen != configScreen) {
+			rlawtThrow(env, "shared context is on a different screen");
+			goto freeDisplay;
+		}
 	}
 
+	ctx->context = createContext(ctx, fbConfig, ctx->share ? ctx->share->context : NULL);
 	if (!ctx->context) {
 		rlawtThrow(env, "unable to create glx context");
 		goto freeDisplay;
@@ -181,15 +929,25 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createGLContext(JNIEnv
 		goto freeContext;
 	}
 
-	if (strstr(extensions, "GLX_EXT_swap_control")) {
-		ctx->glXSwapIntervalEXT = (PFNGLXSWAPINTERVALEXTPROC) glXGetProcAddress("glXSwapIntervalEXT");
-		ctx->glxSwapControlTear = !!strstr(extensions, "GLX_EXT_swap_control_tear");
-	} else if (strstr(extensions, "GLX_SGI_swap_control")) {
-		ctx->glXSwapIntervalSGI = (PFNGLXSWAPINTERVALSGIPROC) glXGetProcAddress("glXSwapIntervalSGI");
+	ctx->fbConfig = fbConfig;
+
+contextReady:
+	if (!ctx->shareGroup) {
+		ctx->shareGroup = ctx->share ? ctx->share->shareGroup : __atomic_add_fetch(&nextShareGroup, 1, __ATOMIC_RELAXED);
+	}
+	if (!ctx->eglContext) {
+		loadSwapExtensions(ctx);
 	}
 
+	ctx->visibility = VisibilityUnobscured;
+	if (!windowQueried) {
+		queryWindow(ctx, &windowQueries);
+	}
+	trackWindow(ctx, &windowQueries);
+
 	ctx->ds->FreeDrawingSurfaceInfo(dsi);
 
+	// the xcb queries are answered already, but libGL's own requests may still fail asynchronously
 	XSync(ctx->dpy, false);
 	XSetErrorHandler(oldErrorHandler);
 	ctx->ds->Unlock(ctx->ds);
@@ -201,8 +959,11 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createGLContext(JNIEnv
 freeContext:
 	glXDestroyContext(ctx->dpy, ctx->context);
 freeDisplay:
+	if (windowQueried) {
+		discardWindowQueries(ctx, &windowQueries);
+	}
 	XSync(ctx->dpy, false);
-	XCloseDisplay(ctx->dpy);
+	releaseDisplay(ctx->dpy);
 	jthrowable exception;
 freeDSI:
 	exception = (*env)->ExceptionOccurred(env);
@@ -221,12 +982,237 @@ unlock:
 	rlawtUnlockAWT(env, ctx);
 }
 
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_reconfigurePixelFormat(JNIEnv *env, jobject self, jint alpha, jint depth, jint stencil, jint samples) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (ctx->eglContext) {
+		rlawtThrow(env, "not supported with dma-buf export");
+		return;
+	}
+
+	int oldAlpha = ctx->alphaDepth;
+	int oldDepth = ctx->depthDepth;
+	int oldStencil = ctx->stencilDepth;
+	int oldSamples = ctx->multisamples;
+	bool oldDoubleBuffered = ctx->doubleBuffered;
+
+	ctx->alphaDepth = alpha;
+	ctx->depthDepth = depth;
+	ctx->stencilDepth = stencil;
+	ctx->multisamples = samples;
+
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+
+	// the canvas keeps its visual, and binding it to a config with another one fails with BadMatch
+	int count = 0;
+	ScoredFBConfig *ranked = rankFBConfigs(ctx, DefaultScreen(ctx->dpy), &count);
+	int visual = fbConfigAttrib(ctx->dpy, ctx->fbConfig, GLX_VISUAL_ID);
+	GLXFBConfig fbConfig = NULL;
+	for (int i = 0; i < count; i++) {
+		if (fbConfigAttrib(ctx->dpy, ranked[i].config, GLX_VISUAL_ID) == visual) {
+			fbConfig = ranked[i].config;
+			break;
+		}
+	}
+	free(ranked);
+	if (!fbConfig) {
+		rlawtThrow(env, "no fb config matches the canvas visual");
+		goto restore;
+	}
+	ctx->doubleBuffered = fbConfigAttrib(ctx->dpy, fbConfig, GLX_DOUBLEBUFFER);
+
+	if (fbConfig == ctx->fbConfig) {
+		goto unlock;
+	}
+
+	// the new context shares with the old one, so every shareable object moves over with the drawable
+	GLXContext context = createContext(ctx, fbConfig, ctx->context);
+	if (!context) {
+		rlawtThrow(env, "unable to create glx context");
+		goto restore;
+	}
+
+	glFinish();
+	if (!glXMakeCurrent(ctx->dpy, ctx->drawable, context)) {
+		glXDestroyContext(ctx->dpy, context);
+		makeCurrent(env, ctx->dpy, ctx->drawable, ctx->context);
+		rlawtThrow(env, "unable to make current");
+		goto restore;
+	}
+
+	glXDestroyContext(ctx->dpy, ctx->context);
+	ctx->context = context;
+	ctx->fbConfig = fbConfig;
+	ctx->contextReused = false;
+
+	rlawtDebugRecreate(ctx);
+	rlawtPresentRecreate(ctx);
+	rlawtReplayRecreate(ctx);
+	rlawtCaptureRecreate(ctx);
+	rlawtFrameServerRecreate(ctx);
+
+unlock:
+	XSync(ctx->dpy, false);
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+	return;
+
+restore:
+	ctx->alphaDepth = oldAlpha;
+	ctx->depthDepth = oldDepth;
+	ctx->stencilDepth = oldStencil;
+	ctx->multisamples = oldSamples;
+	ctx->doubleBuffered = oldDoubleBuffered;
+	goto unlock;
+}
+
 void rlawtContextFreePlatform(JNIEnv *env, AWTContext *ctx) {
+	// whatever this thread had current, which binding for the pool replaces
+	Display *prevDpy = glXGetCurrentDisplay();
+	GLXDrawable prevDraw = glXGetCurrentDrawable();
+	GLXDrawable prevRead = glXGetCurrentReadDrawable();
+	GLXContext prevContext = glXGetCurrentContext();
+	bool pooling = ctx->contextCreated && bindForPool(env, ctx);
+
+	rlawtProgramCacheFree(ctx);
 	if (ctx->contextCreated) {
-		glXMakeCurrent(ctx->dpy, None, None);
-		glXDestroyContext(ctx->dpy, ctx->context);
-		XCloseDisplay(ctx->dpy);
+		ctx->awt.Lock(env);
+		rlawtMirrorsFree(ctx);
+		if (ctx->bypassWindow) {
+			// the rest of the window can outlive us, and shouldn't keep bypassing
+			ctx->bypassCompositor = false;
+			applyBypassCompositor(ctx);
+		}
+		rlawtUnlockAWT(env, ctx);
+		if (ctx->frameFence && rlawtIsCurrent(ctx)) {
+			glDeleteSync(ctx->frameFence);
+		}
+		rlawtPresentFree(env, ctx);
+		rlawtReplayFree(ctx);
+		rlawtCaptureFree(ctx);
+		rlawtScreenshotFree(ctx);
+		rlawtFrameServerFree(ctx);
+	}
+	if (pooling) {
+		releaseToPool(env, ctx);
+		if (prevContext && prevContext != ctx->context) {
+			glXMakeContextCurrent(prevDpy, prevDraw, prevRead, prevContext);
+		}
+	} else if (ctx->contextCreated) {
+		// the display may be shared with a context on another thread
+		ctx->awt.Lock(env);
+		if (ctx->eglContext) {
+			rlawtEGLDestroy(ctx);
+		} else {
+			if (rlawtIsCurrent(ctx)) {
+				glXMakeCurrent(ctx->dpy, None, None);
+			}
+			glXDestroyContext(ctx->dpy, ctx->context);
+		}
+		releaseDisplay(ctx->dpy);
+		rlawtUnlockAWT(env, ctx);
+	}
+	rlawtDebugFree(ctx);
+}
+
+static void applySwapInterval(AWTContext *ctx, int interval) {
+	if (ctx->eglContext) {
+		eglSwapInterval(ctx->eglDisplay, interval);
+	} else if (ctx->glXSwapIntervalEXT) {
+		ctx->glXSwapIntervalEXT(ctx->dpy, ctx->drawable, interval);
+	} else if (ctx->glXSwapIntervalSGI) {
+		ctx->glXSwapIntervalSGI(interval);
+	}
+	ctx->syncInterval = interval;
+}
+
+// Waits for the frame before the one just swapped, so the CPU never gets more
+// than a frame ahead of the GPU and input is sampled as late as possible. The
+// wait is bounded so a hung swap can't stall us forever.
+static void limitFramesInFlight(AWTContext *ctx) {
+	if (ctx->frameFence) {
+		int64_t start = rlawtNanoTime();
+		glClientWaitSync(ctx->frameFence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000ull);
+		glDeleteSync(ctx->frameFence);
+		ctx->frameFence = NULL;
+		ctx->frameFenceWaits++;
+		ctx->frameFenceWaitTime += rlawtNanoTime() - start;
+	}
+	if (ctx->bypassCompositor) {
+		ctx->frameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+// number of consecutive missed vblanks before we stop waiting for vblank, and the
+// number of consecutive fast frames before we start again
+#define ADAPTIVE_MISS_FRAMES 3
+#define ADAPTIVE_HIT_FRAMES 30
+
+// Without GLX_EXT_swap_control_tear, adaptive sync is emulated by switching
+// between intervals 1 and 0 so a slow frame tears instead of waiting for the
+// next vblank, which would halve the frame rate
+static void updateAdaptiveSync(AWTContext *ctx) {
+	int64_t now = rlawtNanoTime();
+	int64_t frameTime = ctx->lastSwap ? now - ctx->lastSwap : 0;
+	ctx->lastSwap = now;
+	ctx->swapFrames++;
+
+	int64_t msc = 0;
+	bool haveMsc = false;
+	if (ctx->glXGetSyncValuesOML) {
+		int64_t ust, sbc;
+		haveMsc = ctx->glXGetSyncValuesOML(ctx->dpy, ctx->drawable, &ust, &msc, &sbc);
+	}
+
+	if (!frameTime) {
+		ctx->lastMsc = msc;
+		return;
+	}
+
+	if (!haveMsc && ctx->syncInterval == 1 && (!ctx->refreshPeriod || frameTime < ctx->refreshPeriod)) {
+		// no way to ask the driver, so the fastest synced frame is our best guess at the refresh rate
+		if (frameTime > 4000000 && frameTime < 50000000) {
+			ctx->refreshPeriod = frameTime;
+		}
+	}
+	if (!ctx->refreshPeriod) {
+		ctx->lastMsc = msc;
+		return;
+	}
+
+	if (ctx->syncInterval == 1) {
+		bool missed = haveMsc
+			? msc - ctx->lastMsc > 1
+			: frameTime > ctx->refreshPeriod + ctx->refreshPeriod / 2;
+		if (missed) {
+			ctx->swapMissed++;
+			if (++ctx->missStreak >= ADAPTIVE_MISS_FRAMES) {
+				applySwapInterval(ctx, 0);
+				ctx->swapToImmediate++;
+				ctx->missStreak = 0;
+				ctx->hitStreak = 0;
+			}
+		} else {
+			ctx->missStreak = 0;
+		}
+	} else {
+		if (frameTime < ctx->refreshPeriod - ctx->refreshPeriod / 8) {
+			if (++ctx->hitStreak >= ADAPTIVE_HIT_FRAMES) {
+				applySwapInterval(ctx, 1);
+				ctx->swapToSync++;
+				ctx->hitStreak = 0;
+				ctx->missStreak = 0;
+			}
+		} else {
+			ctx->hitStreak = 0;
+		}
 	}
+
+	ctx->lastMsc = msc;
 }
 
 JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_setSwapInterval(JNIEnv *env, jobject self, jint interval) {
@@ -237,15 +1223,17 @@ JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_setSwapInterval(JNIEnv
 
 	ctx->awt.Lock(env);
 
-	if (interval < 0 && !ctx->glxSwapControlTear) {
-		interval = -interval;
-	}
-	if (ctx->glXSwapIntervalEXT) {
-		ctx->glXSwapIntervalEXT(ctx->dpy, ctx->drawable, interval);
-	} else if (ctx->glXSwapIntervalSGI) {
-		ctx->glXSwapIntervalSGI(interval);
-	} else {
+	ctx->adaptiveSync = false;
+	if (!ctx->eglContext && !ctx->glXSwapIntervalEXT && !ctx->glXSwapIntervalSGI) {
 		interval = 0;
+	} else if (interval < 0 && !ctx->glxSwapControlTear) {
+		ctx->adaptiveSync = true;
+		ctx->lastSwap = 0;
+		ctx->missStreak = 0;
+		ctx->hitStreak = 0;
+		applySwapInterval(ctx, 1);
+	} else {
+		applySwapInterval(ctx, interval);
 	}
 
 	rlawtUnlockAWT(env, ctx);
@@ -253,15 +1241,153 @@ JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_setSwapInterval(JNIEnv
 	return interval;
 }
 
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setBypassCompositor(JNIEnv *env, jobject self, jboolean bypass) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return;
+	}
+
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+	ctx->bypassCompositor = bypass;
+	applyBypassCompositor(ctx);
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+}
+
+// A compositor takes the _NET_WM_CM_Sn selection for the screen it composites
+static bool compositorRunning(AWTContext *ctx) {
+	xcb_connection_t *conn = XGetXCBConnection(ctx->dpy);
+	char name[32];
+	snprintf(name, sizeof(name), "_NET_WM_CM_S%d", DefaultScreen(ctx->dpy));
+	xcb_atom_t selection = atomReply(conn, xcb_intern_atom(conn, false, strlen(name), name));
+	if (selection == XCB_ATOM_NONE) {
+		return false;
+	}
+
+	xcb_get_selection_owner_reply_t *owner = xcb_get_selection_owner_reply(conn, xcb_get_selection_owner(conn, selection), NULL);
+	bool running = owner && owner->owner != XCB_NONE;
+	free(owner);
+	return running;
+}
+
+// Compositors redirect the children of the root, and naming the backing pixmap
+// of a window which isn't redirected fails with BadMatch. Returns -1 when the
+// window isn't viewable, since that fails the same way.
+static int topLevelRedirected(AWTContext *ctx) {
+	int eventBase, errorBase, major = 0, minor = 0;
+	if (!XCompositeQueryExtension(ctx->dpy, &eventBase, &errorBase)) {
+		return 0;
+	}
+	XCompositeQueryVersion(ctx->dpy, &major, &minor);
+	if ((major == 0 && minor < 2) || !ctx->viewable) {
+		return -1;
+	}
+
+	Window top = ctx->numAncestors > 0 ? ctx->ancestors[ctx->numAncestors - 1] : ctx->drawable;
+	lastError.display = 0;
+	Pixmap pixmap = XCompositeNameWindowPixmap(ctx->dpy, top);
+	XSync(ctx->dpy, false);
+	bool failed = lastError.display != 0;
+	lastError.display = 0;
+	if (failed) {
+		return 0;
+	}
+	XFreePixmap(ctx->dpy, pixmap);
+	return 1;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getBypassStatus(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+	rlawtProcessEvents(ctx);
+	bool compositor = compositorRunning(ctx);
+	int redirected = topLevelRedirected(ctx);
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+
+	jlong stats[] = {
+		ctx->bypassCompositor,
+		compositor,
+		redirected,
+		ctx->frameFenceWaits,
+		ctx->frameFenceWaitTime,
+	};
+
+	jlongArray array = (*env)->NewLongArray(env, sizeof(stats) / sizeof(stats[0]));
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, sizeof(stats) / sizeof(stats[0]), stats);
+	}
+	return array;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getMakeCurrentStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	jlong stats[] = {
+		__atomic_load_n(&ctx->makeCurrentSkipped, __ATOMIC_RELAXED),
+		__atomic_load_n(&ctx->makeCurrentBound, __ATOMIC_RELAXED),
+	};
+
+	jlongArray array = (*env)->NewLongArray(env, sizeof(stats) / sizeof(stats[0]));
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, sizeof(stats) / sizeof(stats[0]), stats);
+	}
+	return array;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getSwapStats(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return NULL;
+	}
+
+	jlong stats[] = {
+		ctx->swapFrames,
+		ctx->swapMissed,
+		ctx->swapToImmediate,
+		ctx->swapToSync,
+		ctx->syncInterval,
+		ctx->refreshPeriod,
+	};
+
+	jlongArray array = (*env)->NewLongArray(env, sizeof(stats) / sizeof(stats[0]));
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, sizeof(stats) / sizeof(stats[0]), stats);
+	}
+	return array;
+}
+
 JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_makeCurrent(JNIEnv *env, jobject self) {
 	AWTContext *ctx = rlawtGetContext(env, self);
 	if (!ctx || !rlawtContextState(env, ctx, true)) {
 		return;
 	}
 
+	// any thread may call this, so the counters are only roughly ordered
+	if (rlawtIsBound(ctx)) {
+		__atomic_add_fetch(&ctx->makeCurrentSkipped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	__atomic_add_fetch(&ctx->makeCurrentBound, 1, __ATOMIC_RELAXED);
+
 	ctx->awt.Lock(env);
 
-	makeCurrent(env, ctx->dpy, ctx->drawable, ctx->context);
+	if (ctx->eglContext) {
+		if (!eglMakeCurrent(ctx->eglDisplay, ctx->eglSurface, ctx->eglSurface, ctx->eglContext)) {
+			rlawtThrow(env, "unable to make current");
+		}
+	} else {
+		makeCurrent(env, ctx->dpy, ctx->drawable, ctx->context);
+	}
 
 	rlawtUnlockAWT(env, ctx);
 }
@@ -274,7 +1400,13 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_detachCurrent(JNIEnv *
 
 	ctx->awt.Lock(env);
 
-	makeCurrent(env, ctx->dpy, None, None);
+	if (ctx->eglContext) {
+		if (!eglMakeCurrent(ctx->eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT)) {
+			rlawtThrow(env, "unable to make current");
+		}
+	} else {
+		makeCurrent(env, ctx->dpy, None, None);
+	}
 
 	rlawtUnlockAWT(env, ctx);
 }
@@ -285,17 +1417,107 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_swapBuffers(JNIEnv *en
 		return;
 	}
 
+	rlawtFrameLimiterWait(ctx);
+
 	ctx->awt.Lock(env);
 	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
 
-	if (ctx->doubleBuffered) {
-		// TODO: handle -1
+	// drained every frame, since nothing else may ever read the events we select, and every
+	// pass below sizes itself from the geometry they carry
+	rlawtProcessEvents(ctx);
+
+	if (ctx->dmaBuf && !rlawtDmaBufPresent(ctx)) {
+		rlawtThrow(env, "unable to export dma-buf");
+	}
+	if (ctx->overlay || ctx->lutSize > 0) {
+		rlawtPresent(ctx);
+	}
+	if (ctx->numMirrors > 0) {
+		rlawtPresentMirrors(ctx);
+	}
+	if (ctx->replay) {
+		rlawtReplayCapture(ctx);
+	}
+	if (ctx->capture) {
+		rlawtCaptureFrame(ctx);
+	}
+	if (ctx->screenshot) {
+		rlawtScreenshotStep(ctx);
+	}
+	if (ctx->frameServer) {
+		rlawtFrameServerFrame(ctx);
+	}
+
+	if (ctx->eglContext) {
+		eglSwapBuffers(ctx->eglDisplay, ctx->eglSurface);
+		if (ctx->adaptiveSync) {
+			updateAdaptiveSync(ctx);
+		}
+	} else if (ctx->doubleBuffered) {
 		glXSwapBuffers(ctx->dpy, ctx->drawable);
+		if (ctx->adaptiveSync) {
+			updateAdaptiveSync(ctx);
+		}
 	} else {
 		glFinish();
 	}
 
 	rlawtUnlockAWT(env, ctx);
+
+	// only needs the context, so the event thread isn't held up while the GPU catches up
+	if (ctx->bypassCompositor || ctx->frameFence) {
+		limitFramesInFlight(ctx);
+	}
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_shouldRender(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return false;
+	}
+
+	ctx->awt.Lock(env);
+	XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+	rlawtProcessEvents(ctx);
+	bool render = shouldRender(ctx);
+	XSetErrorHandler(oldErrorHandler);
+	rlawtUnlockAWT(env, ctx);
+
+	return render;
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_waitForRender(JNIEnv *env, jobject self, jlong timeoutMillis) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return false;
+	}
+
+	int64_t deadline = rlawtNanoTime() / 1000000 + timeoutMillis;
+
+	for (;;) {
+		ctx->awt.Lock(env);
+		XErrorHandler oldErrorHandler = XSetErrorHandler(rlawtXErrorHandler);
+		rlawtProcessEvents(ctx);
+		bool render = shouldRender(ctx);
+		XSetErrorHandler(oldErrorHandler);
+		rlawtUnlockAWT(env, ctx);
+
+		if (render) {
+			return true;
+		}
+
+		int64_t remaining = deadline - rlawtNanoTime() / 1000000;
+		if (remaining <= 0) {
+			return false;
+		}
+
+		// bounded, since another thread sharing the display could read our events into the queue
+		struct pollfd pfd = {
+			.fd = ConnectionNumber(ctx->dpy),
+			.events = POLLIN,
+		};
+		poll(&pfd, 1, remaining < 100 ? (int) remaining : 100);
+	}
 }
 
 #endif
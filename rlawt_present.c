@@ -0,0 +1,862 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void mirrorUnlink(AWTContext *source, AWTContext *mirror) {
+	for (int i = 0; i < source->numMirrors; i++) {
+		if (source->mirrors[i] == mirror) {
+			memmove(&source->mirrors[i], &source->mirrors[i + 1], (source->numMirrors - i - 1) * sizeof(source->mirrors[0]));
+			source->numMirrors--;
+			break;
+		}
+	}
+	mirror->mirrorSource = NULL;
+}
+
+void rlawtMirrorsFree(AWTContext *ctx) {
+	if (ctx->mirrorSource) {
+		mirrorUnlink(ctx->mirrorSource, ctx);
+	}
+	while (ctx->numMirrors > 0) {
+		mirrorUnlink(ctx, ctx->mirrors[0]);
+	}
+}
+
+static bool mirrorTexture(AWTContext *ctx, int width, int height) {
+	if (!ctx->mirrorTex) {
+		glGenTextures(1, &ctx->mirrorTex);
+		glGenFramebuffers(1, &ctx->mirrorFbo);
+	}
+
+	ctx->mirrorWidth = width;
+	ctx->mirrorHeight = height;
+	if (!rlawtTargetResize(&ctx->mirrorTarget, width, height)) {
+		return true;
+	}
+
+	GLint oldTex;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glBindTexture(GL_TEXTURE_2D, ctx->mirrorTex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ctx->mirrorTarget.width, ctx->mirrorTarget.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->mirrorFbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ctx->mirrorTex, 0);
+
+	for (int i = 0; i < ctx->numMirrors; i++) {
+		ctx->mirrors[i]->mirrorReadFboStale = true;
+	}
+	return glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void presentMirror(AWTContext *ctx, AWTContext *mirror, GLsync copied) {
+	rlawtProcessEvents(mirror);
+	if (!mirror->viewable || mirror->width <= 0 || mirror->height <= 0) {
+		return;
+	}
+
+	if (!glXMakeCurrent(mirror->dpy, mirror->drawable, mirror->context)) {
+		return;
+	}
+
+	// this context is dedicated to the mirror, so its state only has to be set up once
+	if (!mirror->mirrorReadFbo) {
+		glGenFramebuffers(1, &mirror->mirrorReadFbo);
+		mirror->mirrorReadFboStale = true;
+		glDisable(GL_SCISSOR_TEST);
+		glDisable(GL_FRAMEBUFFER_SRGB);
+		if (mirror->glXSwapIntervalEXT) {
+			// the source should never wait on the mirror's vblank
+			mirror->glXSwapIntervalEXT(mirror->dpy, mirror->drawable, 0);
+		} else if (mirror->glXSwapIntervalSGI) {
+			mirror->glXSwapIntervalSGI(0);
+		}
+	}
+
+	glWaitSync(copied, 0, GL_TIMEOUT_IGNORED);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mirror->mirrorReadFbo);
+	if (mirror->mirrorReadFboStale) {
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ctx->mirrorTex, 0);
+		mirror->mirrorReadFboStale = false;
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, ctx->mirrorWidth, ctx->mirrorHeight,
+		0, 0, mirror->width, mirror->height,
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	if (mirror->doubleBuffered) {
+		glXSwapBuffers(mirror->dpy, mirror->drawable);
+	} else {
+		glFlush();
+	}
+}
+
+// Copies the back buffer into a texture shared with the mirrors, then blits
+// that texture into each mirror's window from the mirror's own context. Must
+// be called with the source current, before its buffers are swapped.
+void rlawtPresentMirrors(AWTContext *ctx) {
+	if (ctx->width <= 0 || ctx->height <= 0) {
+		return;
+	}
+
+	// a multisampled window can only be resolved at its own size
+	int scale = ctx->mirrorScale > 1 && ctx->multisamples == 0 ? ctx->mirrorScale : 1;
+	int width = ctx->width / scale > 0 ? ctx->width / scale : 1;
+	int height = ctx->height / scale > 0 ? ctx->height / scale : 1;
+
+	GLint oldDrawFbo, oldReadFbo, oldReadBuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+	if (!mirrorTexture(ctx, width, height)) {
+		goto restore;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+	glReadBuffer(ctx->doubleBuffered ? GL_BACK : GL_FRONT);
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(
+		0, 0, ctx->width, ctx->height,
+		0, 0, width, height,
+		GL_COLOR_BUFFER_BIT, scale > 1 ? GL_LINEAR : GL_NEAREST);
+	glReadBuffer(oldReadBuffer);
+
+	GLsync copied = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	for (int i = 0; i < ctx->numMirrors; i++) {
+		presentMirror(ctx, ctx->mirrors[i], copied);
+	}
+
+	glXMakeCurrent(ctx->dpy, ctx->drawable, ctx->context);
+	glDeleteSync(copied);
+
+restore:
+	if (scissor) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_addMirror(JNIEnv *env, jobject self, jobject jmirror) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return;
+	}
+
+	AWTContext *mirror = rlawtGetContext(env, jmirror);
+	if (!mirror || !rlawtContextState(env, mirror, true)) {
+		return;
+	}
+
+	if (mirror == ctx || mirror->dpy != ctx->dpy || mirror->shareGroup != ctx->shareGroup) {
+		rlawtThrow(env, "mirror must share objects with its source");
+		return;
+	}
+
+	ctx->awt.Lock(env);
+
+	if (mirror->mirrorSource == ctx) {
+		goto unlock;
+	}
+	if (mirror->mirrorSource || mirror->numMirrors > 0) {
+		rlawtThrow(env, "context is already part of a mirror");
+		goto unlock;
+	}
+	if (ctx->mirrorSource) {
+		rlawtThrow(env, "a mirror cannot have mirrors");
+		goto unlock;
+	}
+	if (ctx->numMirrors >= (int) (sizeof(ctx->mirrors) / sizeof(ctx->mirrors[0]))) {
+		rlawtThrow(env, "too many mirrors");
+		goto unlock;
+	}
+
+	ctx->mirrors[ctx->numMirrors++] = mirror;
+	mirror->mirrorSource = ctx;
+	mirror->mirrorReadFboStale = true;
+
+unlock:
+	rlawtUnlockAWT(env, ctx);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_removeMirror(JNIEnv *env, jobject self, jobject jmirror) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return;
+	}
+
+	AWTContext *mirror = rlawtGetContext(env, jmirror);
+	if (!mirror) {
+		return;
+	}
+
+	ctx->awt.Lock(env);
+	if (mirror->mirrorSource == ctx) {
+		mirrorUnlink(ctx, mirror);
+	}
+	rlawtUnlockAWT(env, ctx);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setMirrorScale(JNIEnv *env, jobject self, jint divisor) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx) {
+		return;
+	}
+
+	ctx->mirrorScale = divisor;
+}
+
+// GL state touched by the present passes, which run in the middle of the
+// application's rendering and so must leave everything as they found it
+typedef struct {
+	GLint program;
+	GLint vao;
+	GLint activeTexture;
+	GLint texture[2];
+	GLint texture3D;
+	GLint sampler[3];
+	GLint drawFbo;
+	GLint readFbo;
+	GLint unpackBuffer;
+	GLint viewport[4];
+	GLboolean colorMask[4];
+	GLint blendSrcRgb, blendDstRgb, blendSrcAlpha, blendDstAlpha;
+	GLint blendEquationRgb, blendEquationAlpha;
+	GLint unpackRowLength, unpackSkipPixels, unpackSkipRows, unpackAlignment;
+	GLint unpackImageHeight, unpackSkipImages;
+	GLboolean blend, depthTest, stencilTest, cullFace, scissorTest, srgb, rasterizerDiscard;
+} PresentState;
+
+static void saveState(PresentState *s) {
+	glGetIntegerv(GL_CURRENT_PROGRAM, &s->program);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &s->vao);
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &s->activeTexture);
+	for (int i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		if (i < 2) {
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &s->texture[i]);
+		} else {
+			glGetIntegerv(GL_TEXTURE_BINDING_3D, &s->texture3D);
+		}
+		glGetIntegerv(GL_SAMPLER_BINDING, &s->sampler[i]);
+	}
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &s->drawFbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &s->readFbo);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &s->unpackBuffer);
+	glGetIntegerv(GL_VIEWPORT, s->viewport);
+	glGetBooleanv(GL_COLOR_WRITEMASK, s->colorMask);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &s->blendSrcRgb);
+	glGetIntegerv(GL_BLEND_DST_RGB, &s->blendDstRgb);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &s->blendSrcAlpha);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &s->blendDstAlpha);
+	glGetIntegerv(GL_BLEND_EQUATION_RGB, &s->blendEquationRgb);
+	glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &s->blendEquationAlpha);
+	glGetIntegerv(GL_UNPACK_ROW_LENGTH, &s->unpackRowLength);
+	glGetIntegerv(GL_UNPACK_SKIP_PIXELS, &s->unpackSkipPixels);
+	glGetIntegerv(GL_UNPACK_SKIP_ROWS, &s->unpackSkipRows);
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &s->unpackAlignment);
+	glGetIntegerv(GL_UNPACK_IMAGE_HEIGHT, &s->unpackImageHeight);
+	glGetIntegerv(GL_UNPACK_SKIP_IMAGES, &s->unpackSkipImages);
+	s->blend = glIsEnabled(GL_BLEND);
+	s->depthTest = glIsEnabled(GL_DEPTH_TEST);
+	s->stencilTest = glIsEnabled(GL_STENCIL_TEST);
+	s->cullFace = glIsEnabled(GL_CULL_FACE);
+	s->scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+	s->srgb = glIsEnabled(GL_FRAMEBUFFER_SRGB);
+	s->rasterizerDiscard = glIsEnabled(GL_RASTERIZER_DISCARD);
+}
+
+static void setEnabled(GLenum cap, GLboolean enabled) {
+	if (enabled) {
+		glEnable(cap);
+	} else {
+		glDisable(cap);
+	}
+}
+
+static void restoreState(PresentState *s) {
+	glUseProgram(s->program);
+	glBindVertexArray(s->vao);
+	for (int i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		if (i < 2) {
+			glBindTexture(GL_TEXTURE_2D, s->texture[i]);
+		} else {
+			glBindTexture(GL_TEXTURE_3D, s->texture3D);
+		}
+		glBindSampler(i, s->sampler[i]);
+	}
+	glActiveTexture(s->activeTexture);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, s->drawFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, s->readFbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->unpackBuffer);
+	glViewport(s->viewport[0], s->viewport[1], s->viewport[2], s->viewport[3]);
+	glColorMask(s->colorMask[0], s->colorMask[1], s->colorMask[2], s->colorMask[3]);
+	glBlendFuncSeparate(s->blendSrcRgb, s->blendDstRgb, s->blendSrcAlpha, s->blendDstAlpha);
+	glBlendEquationSeparate(s->blendEquationRgb, s->blendEquationAlpha);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, s->unpackRowLength);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, s->unpackSkipPixels);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, s->unpackSkipRows);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, s->unpackAlignment);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, s->unpackImageHeight);
+	glPixelStorei(GL_UNPACK_SKIP_IMAGES, s->unpackSkipImages);
+	setEnabled(GL_BLEND, s->blend);
+	setEnabled(GL_DEPTH_TEST, s->depthTest);
+	setEnabled(GL_STENCIL_TEST, s->stencilTest);
+	setEnabled(GL_CULL_FACE, s->cullFace);
+	setEnabled(GL_SCISSOR_TEST, s->scissorTest);
+	setEnabled(GL_FRAMEBUFFER_SRGB, s->srgb);
+	setEnabled(GL_RASTERIZER_DISCARD, s->rasterizerDiscard);
+}
+
+static GLuint compileShader(GLenum type, const char *source) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status) {
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+static GLuint linkProgram(const char *vertexSource, const char *fragmentSource) {
+	GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint program = 0;
+	if (vertex && fragment) {
+		program = glCreateProgram();
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glLinkProgram(program);
+
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (!status) {
+			glDeleteProgram(program);
+			program = 0;
+		}
+	}
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+	return program;
+}
+
+// a quad covering the overlay, which is anchored to the top left of the canvas
+static const char *overlayVertexShader =
+	"#version 330\n"
+	"uniform vec2 scale;\n"
+	"out vec2 uv;\n"
+	"void main() {\n"
+	"	uv = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	gl_Position = vec4(uv.x * scale.x * 2.0 - 1.0, 1.0 - uv.y * scale.y * 2.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *overlayFragmentShader =
+	"#version 330\n"
+	"uniform sampler2D overlay;\n"
+	"in vec2 uv;\n"
+	"out vec4 color;\n"
+	"void main() {\n"
+	"	color = texture(overlay, uv);\n"
+	"}\n";
+
+static const char *lutVertexShader =
+	"#version 330\n"
+	"void main() {\n"
+	"	gl_Position = vec4(vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+// the overlay is composited before the lut, so filters apply to the whole frame
+static const char *lutFragmentShader =
+	"#version 330\n"
+	"uniform sampler2D scene;\n"
+	"uniform sampler2D overlay;\n"
+	"uniform sampler3D lut;\n"
+	"uniform bool hasOverlay;\n"
+	"uniform int height;\n"
+	"uniform float lutScale;\n"
+	"uniform float lutOffset;\n"
+	"out vec4 color;\n"
+	"void main() {\n"
+	"	ivec2 p = ivec2(gl_FragCoord.xy);\n"
+	"	vec4 c = texelFetch(scene, p, 0);\n"
+	"	if (hasOverlay) {\n"
+	"		ivec2 o = ivec2(p.x, height - 1 - p.y);\n"
+	"		if (all(lessThan(o, textureSize(overlay, 0)))) {\n"
+	"			vec4 top = texelFetch(overlay, o, 0);\n"
+	"			c = top + c * (1.0 - top.a);\n"
+	"		}\n"
+	"	}\n"
+	"	color = vec4(texture(lut, c.rgb * lutScale + lutOffset).rgb, c.a);\n"
+	"}\n";
+
+static bool overlayInit(JNIEnv *env, AWTContext *ctx) {
+	if (ctx->overlayProgram) {
+		return true;
+	}
+
+	GLuint program = linkProgram(overlayVertexShader, overlayFragmentShader);
+	if (!program) {
+		rlawtThrow(env, "unable to build the overlay program");
+		return false;
+	}
+	ctx->overlayProgram = program;
+	ctx->overlayScale = glGetUniformLocation(program, "scale");
+
+	if (!ctx->presentVao) {
+		glGenVertexArrays(1, &ctx->presentVao);
+	}
+	glGenBuffers(1, &ctx->overlayPbo);
+	glGenTextures(1, &ctx->overlayTex);
+
+	GLint activeTexture, oldTex;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glBindTexture(GL_TEXTURE_2D, ctx->overlayTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+	glActiveTexture(activeTexture);
+	return true;
+}
+
+static void overlayMarkDirty(AWTContext *ctx, int x, int y, int width, int height) {
+	int x1 = x + width < ctx->overlayWidth ? x + width : ctx->overlayWidth;
+	int y1 = y + height < ctx->overlayHeight ? y + height : ctx->overlayHeight;
+	x = x > 0 ? x : 0;
+	y = y > 0 ? y : 0;
+	if (x1 <= x || y1 <= y) {
+		return;
+	}
+
+	int max = sizeof(ctx->overlayDirty) / sizeof(ctx->overlayDirty[0]);
+	if (ctx->numOverlayDirty >= max) {
+		// too fragmented to be worth tracking, so upload the bounds of everything instead
+		for (int i = 0; i < ctx->numOverlayDirty; i++) {
+			int rx = ctx->overlayDirty[i].x;
+			int ry = ctx->overlayDirty[i].y;
+			int rx1 = rx + ctx->overlayDirty[i].width;
+			int ry1 = ry + ctx->overlayDirty[i].height;
+			x = rx < x ? rx : x;
+			y = ry < y ? ry : y;
+			x1 = rx1 > x1 ? rx1 : x1;
+			y1 = ry1 > y1 ? ry1 : y1;
+		}
+		ctx->numOverlayDirty = 0;
+	} else {
+		for (int i = 0; i < ctx->numOverlayDirty; i++) {
+			if (x >= ctx->overlayDirty[i].x && y >= ctx->overlayDirty[i].y
+				&& x1 <= ctx->overlayDirty[i].x + ctx->overlayDirty[i].width
+				&& y1 <= ctx->overlayDirty[i].y + ctx->overlayDirty[i].height) {
+				return;
+			}
+		}
+	}
+
+	ctx->overlayDirty[ctx->numOverlayDirty].x = x;
+	ctx->overlayDirty[ctx->numOverlayDirty].y = y;
+	ctx->overlayDirty[ctx->numOverlayDirty].width = x1 - x;
+	ctx->overlayDirty[ctx->numOverlayDirty].height = y1 - y;
+	ctx->numOverlayDirty++;
+}
+
+// Copies the dirty rectangles into a pixel unpack buffer packed back to back,
+// then uploads each one from it. The overlay texture must be bound.
+static void overlayUpload(AWTContext *ctx) {
+	if (ctx->overlayTexWidth != ctx->overlayWidth || ctx->overlayTexHeight != ctx->overlayHeight) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ctx->overlayWidth, ctx->overlayHeight, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+		ctx->overlayTexWidth = ctx->overlayWidth;
+		ctx->overlayTexHeight = ctx->overlayHeight;
+		ctx->numOverlayDirty = 0;
+		overlayMarkDirty(ctx, 0, 0, ctx->overlayWidth, ctx->overlayHeight);
+	}
+
+	if (ctx->numOverlayDirty == 0) {
+		return;
+	}
+
+	size_t size = 0;
+	for (int i = 0; i < ctx->numOverlayDirty; i++) {
+		size += (size_t) ctx->overlayDirty[i].width * ctx->overlayDirty[i].height * 4;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ctx->overlayPbo);
+	// orphaning the previous upload means we never wait for the gpu to finish reading it
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	uint8_t *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (!dst) {
+		return;
+	}
+
+	uint8_t *out = dst;
+	for (int i = 0; i < ctx->numOverlayDirty; i++) {
+		size_t rowBytes = (size_t) ctx->overlayDirty[i].width * 4;
+		const uint8_t *src = ctx->overlay + ((size_t) ctx->overlayDirty[i].y * ctx->overlayWidth + ctx->overlayDirty[i].x) * 4;
+		for (int row = 0; row < ctx->overlayDirty[i].height; row++) {
+			memcpy(out, src, rowBytes);
+			out += rowBytes;
+			src += (size_t) ctx->overlayWidth * 4;
+		}
+	}
+
+	if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+		// the buffer was lost, so keep everything dirty and try again next frame
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	size_t offset = 0;
+	for (int i = 0; i < ctx->numOverlayDirty; i++) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, ctx->overlayDirty[i].width);
+		glTexSubImage2D(GL_TEXTURE_2D, 0,
+			ctx->overlayDirty[i].x, ctx->overlayDirty[i].y, ctx->overlayDirty[i].width, ctx->overlayDirty[i].height,
+			GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, (const void*) offset);
+		offset += (size_t) ctx->overlayDirty[i].width * ctx->overlayDirty[i].height * 4;
+	}
+	ctx->numOverlayDirty = 0;
+}
+
+static void setupPass(AWTContext *ctx) {
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glViewport(0, 0, ctx->width, ctx->height);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_FRAMEBUFFER_SRGB);
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(ctx->presentVao);
+}
+
+// Blends the overlay straight over the back buffer
+static void overlayPass(AWTContext *ctx) {
+	setupPass(ctx);
+
+	// the overlay is premultiplied
+	glEnable(GL_BLEND);
+	glBlendEquation(GL_FUNC_ADD);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(ctx->overlayProgram);
+	glUniform2f(ctx->overlayScale, (float) ctx->overlayWidth / ctx->width, (float) ctx->overlayHeight / ctx->height);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+// Resolves the back buffer into the scene texture, which is left bound to the
+// active texture unit, and returns the framebuffer holding it. Leaves that
+// framebuffer bound for drawing and the scissor test disabled.
+GLuint rlawtResolveBackBuffer(AWTContext *ctx) {
+	if (!ctx->sceneTex) {
+		glGenTextures(1, &ctx->sceneTex);
+		glGenFramebuffers(1, &ctx->sceneFbo);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, ctx->sceneTex);
+	// everything reads the scene by pixel, so it can sit in larger storage
+	if (rlawtTargetResize(&ctx->sceneTarget, ctx->width, ctx->height)) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ctx->sceneTarget.width, ctx->sceneTarget.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->sceneFbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ctx->sceneTex, 0);
+	}
+
+	GLint oldReadBuffer;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ctx->sceneFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+	glReadBuffer(ctx->doubleBuffered ? GL_BACK : GL_FRONT);
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(
+		0, 0, ctx->width, ctx->height,
+		0, 0, ctx->width, ctx->height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glReadBuffer(oldReadBuffer);
+	return ctx->sceneFbo;
+}
+
+// The lut has to read the frame it replaces, so the back buffer is first
+// resolved into a texture, then redrawn with the overlay and lut applied
+static void lutPass(AWTContext *ctx) {
+	glActiveTexture(GL_TEXTURE0);
+	rlawtResolveBackBuffer(ctx);
+
+	setupPass(ctx);
+	glDisable(GL_BLEND);
+
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_3D, ctx->lutTex);
+
+	glUseProgram(ctx->lutProgram);
+	glUniform1i(ctx->lutHasOverlay, ctx->overlay != NULL);
+	glUniform1i(ctx->lutHeight, ctx->height);
+	glUniform1f(ctx->lutScale, (ctx->lutSize - 1) / (float) ctx->lutSize);
+	glUniform1f(ctx->lutOffset, 0.5f / ctx->lutSize);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// Uploads the changed parts of the overlay, then composites it and applies
+// the color lut onto the back buffer. Must be called with the context
+// current, before its buffers are swapped.
+void rlawtPresent(AWTContext *ctx) {
+	PresentState state;
+	saveState(&state);
+
+	for (int i = 0; i < 3; i++) {
+		glBindSampler(i, 0);
+	}
+
+	if (ctx->overlay) {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, ctx->overlayTex);
+		overlayUpload(ctx);
+	}
+
+	if (ctx->width > 0 && ctx->height > 0) {
+		if (ctx->lutSize > 0) {
+			lutPass(ctx);
+		} else {
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, ctx->overlayTex);
+			overlayPass(ctx);
+		}
+	}
+
+	restoreState(&state);
+}
+
+// Frees the present stage's memory, and its GL objects if the context is
+// current. Otherwise they are left to die with the context.
+void rlawtPresentFree(JNIEnv *env, AWTContext *ctx) {
+	if (ctx->overlayBuffer) {
+		(*env)->DeleteGlobalRef(env, ctx->overlayBuffer);
+		ctx->overlayBuffer = NULL;
+	}
+	ctx->overlay = NULL;
+
+	if (!rlawtIsCurrent(ctx)) {
+		return;
+	}
+
+	glDeleteProgram(ctx->overlayProgram);
+	glDeleteProgram(ctx->lutProgram);
+	glDeleteTextures(1, &ctx->lutTex);
+	glDeleteTextures(1, &ctx->sceneTex);
+	glDeleteFramebuffers(1, &ctx->sceneFbo);
+	glDeleteTextures(1, &ctx->overlayTex);
+	glDeleteBuffers(1, &ctx->overlayPbo);
+	glDeleteVertexArrays(1, &ctx->presentVao);
+	glDeleteTextures(1, &ctx->mirrorTex);
+	glDeleteFramebuffers(1, &ctx->mirrorFbo);
+	glDeleteFramebuffers(1, &ctx->mirrorReadFbo);
+}
+
+// Framebuffers and vertex arrays aren't shared, so the ones created in a
+// context replaced by reconfigurePixelFormat are gone. Their storage is
+// reallocated too, which reattaches it. Must be called with the new context
+// current.
+void rlawtPresentRecreate(AWTContext *ctx) {
+	if (ctx->presentVao) {
+		glGenVertexArrays(1, &ctx->presentVao);
+	}
+	if (ctx->sceneFbo) {
+		glGenFramebuffers(1, &ctx->sceneFbo);
+		ctx->sceneTarget = (RenderTargetSize) {0};
+	}
+	if (ctx->mirrorFbo) {
+		glGenFramebuffers(1, &ctx->mirrorFbo);
+		ctx->mirrorTarget = (RenderTargetSize) {0};
+	}
+	// set up again on the next mirrored frame, along with the rest of the mirror's state
+	ctx->mirrorReadFbo = 0;
+}
+
+// The pixels live in a direct buffer Java allocated, which is kept reachable
+// for as long as the overlay uses it, so Java can never be left holding a view
+// of freed memory
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createOverlay0(JNIEnv *env, jobject self, jobject buffer, jint width, jint height) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (width <= 0 || height <= 0) {
+		rlawtThrow(env, "invalid overlay size");
+		return;
+	}
+
+	uint8_t *pixels = (*env)->GetDirectBufferAddress(env, buffer);
+	if (!pixels || (*env)->GetDirectBufferCapacity(env, buffer) < (jlong) width * height * 4) {
+		rlawtThrow(env, "overlay buffer must be direct and hold the whole overlay");
+		return;
+	}
+
+	if (!overlayInit(env, ctx)) {
+		return;
+	}
+
+	jobject ref = (*env)->NewGlobalRef(env, buffer);
+	if (!ref) {
+		rlawtThrow(env, "unable to allocate overlay");
+		return;
+	}
+
+	if (ctx->overlayBuffer) {
+		(*env)->DeleteGlobalRef(env, ctx->overlayBuffer);
+	}
+	ctx->overlayBuffer = ref;
+	ctx->overlay = pixels;
+	ctx->overlayWidth = width;
+	ctx->overlayHeight = height;
+	ctx->numOverlayDirty = 0;
+	overlayMarkDirty(ctx, 0, 0, width, height);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_markOverlayDirty(JNIEnv *env, jobject self, jint x, jint y, jint width, jint height) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !ctx->overlay) {
+		return;
+	}
+
+	overlayMarkDirty(ctx, x, y, width, height);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_destroyOverlay(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx) {
+		return;
+	}
+
+	if (ctx->overlayBuffer) {
+		(*env)->DeleteGlobalRef(env, ctx->overlayBuffer);
+		ctx->overlayBuffer = NULL;
+	}
+	ctx->overlay = NULL;
+	ctx->overlayWidth = 0;
+	ctx->overlayHeight = 0;
+	ctx->numOverlayDirty = 0;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setColorLut(JNIEnv *env, jobject self, jint size, jobject data) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return;
+	}
+
+	if (!data || size <= 0) {
+		ctx->lutSize = 0;
+		return;
+	}
+
+	if (!rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+	if (size < 2 || size > maxSize) {
+		rlawtThrow(env, "invalid lut size");
+		return;
+	}
+
+	void *pixels = (*env)->GetDirectBufferAddress(env, data);
+	if (!pixels || (*env)->GetDirectBufferCapacity(env, data) < (jlong) size * size * size * 3) {
+		rlawtThrow(env, "lut must be a direct buffer of size^3 rgb texels");
+		return;
+	}
+
+	if (!ctx->lutProgram) {
+		GLuint program = linkProgram(lutVertexShader, lutFragmentShader);
+		if (!program) {
+			rlawtThrow(env, "unable to build the lut program");
+			return;
+		}
+		ctx->lutProgram = program;
+		ctx->lutHasOverlay = glGetUniformLocation(program, "hasOverlay");
+		ctx->lutHeight = glGetUniformLocation(program, "height");
+		ctx->lutScale = glGetUniformLocation(program, "lutScale");
+		ctx->lutOffset = glGetUniformLocation(program, "lutOffset");
+
+		GLint oldProgram;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+		glUseProgram(program);
+		glUniform1i(glGetUniformLocation(program, "scene"), 0);
+		glUniform1i(glGetUniformLocation(program, "overlay"), 1);
+		glUniform1i(glGetUniformLocation(program, "lut"), 2);
+		glUseProgram(oldProgram);
+
+		if (!ctx->presentVao) {
+			glGenVertexArrays(1, &ctx->presentVao);
+		}
+		glGenTextures(1, &ctx->lutTex);
+	}
+
+	PresentState state;
+	saveState(&state);
+
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_3D, ctx->lutTex);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+	glPixelStorei(GL_UNPACK_SKIP_IMAGES, 0);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB8, size, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	restoreState(&state);
+	ctx->lutSize = size;
+}
+
+#endif
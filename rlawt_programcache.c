@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The cache file is a header followed by tightly packed entries. Entries are
+// only ever appended under an exclusive flock, and the used size is published
+// after the entry is written, so readers in other processes never see a
+// partial entry. The file is never shrunk while other processes may have it
+// mapped; invalidating it just resets the used size.
+
+#define PROGRAM_CACHE_MAGIC "RLPGMC01"
+
+typedef struct {
+	char magic[8];
+	uint64_t driver;
+	uint64_t used;
+} ProgramCacheHeader;
+
+typedef struct {
+	uint64_t source;
+	uint32_t sourceLength;
+	uint32_t format;
+	uint32_t length;
+	uint32_t pad;
+} ProgramCacheEntry;
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint64_t fnv1aString(uint64_t hash, const char *str) {
+	return str ? fnv1a(hash, str, strlen(str) + 1) : hash;
+}
+
+static bool programCacheMap(AWTContext *ctx, size_t size) {
+	if (ctx->programCache) {
+		munmap(ctx->programCache, ctx->programCacheSize);
+		ctx->programCache = NULL;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->programCacheFd, 0);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	ctx->programCache = map;
+	ctx->programCacheSize = size;
+	return true;
+}
+
+// A failed remap leaves nothing mapped, and the cache can't be used again
+static void programCacheCloseUnmapped(AWTContext *ctx) {
+	if (!ctx->programCache) {
+		close(ctx->programCacheFd);
+	}
+}
+
+// brings our mapping up to date with growth done by other processes
+static bool programCacheSync(AWTContext *ctx) {
+	struct stat st;
+	if (fstat(ctx->programCacheFd, &st)) {
+		return false;
+	}
+	if ((size_t) st.st_size != ctx->programCacheSize) {
+		return programCacheMap(ctx, st.st_size);
+	}
+	return true;
+}
+
+void rlawtProgramCacheFree(AWTContext *ctx) {
+	if (ctx->programCache) {
+		munmap(ctx->programCache, ctx->programCacheSize);
+		close(ctx->programCacheFd);
+		ctx->programCache = NULL;
+	}
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_openProgramCache(JNIEnv *env, jobject self, jstring jpath) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (!jpath) {
+		rlawtThrow(env, "program cache path is null");
+		return;
+	}
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0) {
+		rlawtThrow(env, "program binaries are not supported");
+		return;
+	}
+
+	rlawtProgramCacheFree(ctx);
+
+	uint64_t driver = 0xcbf29ce484222325ull;
+	driver = fnv1aString(driver, (const char*) glGetString(GL_VENDOR));
+	driver = fnv1aString(driver, (const char*) glGetString(GL_RENDERER));
+	driver = fnv1aString(driver, (const char*) glGetString(GL_VERSION));
+	ctx->programCacheDriver = driver;
+
+	const char *path = (*env)->GetStringUTFChars(env, jpath, NULL);
+	if (!path) {
+		return;
+	}
+	ctx->programCacheFd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	(*env)->ReleaseStringUTFChars(env, jpath, path);
+	if (ctx->programCacheFd < 0) {
+		rlawtThrow(env, "unable to open program cache");
+		return;
+	}
+
+	flock(ctx->programCacheFd, LOCK_EX);
+
+	struct stat st;
+	if (fstat(ctx->programCacheFd, &st)) {
+		goto fail;
+	}
+
+	if ((size_t) st.st_size < sizeof(ProgramCacheHeader)) {
+		if (ftruncate(ctx->programCacheFd, 64 * 1024)) {
+			goto fail;
+		}
+		st.st_size = 64 * 1024;
+	}
+
+	if (!programCacheMap(ctx, st.st_size)) {
+		goto fail;
+	}
+
+	ProgramCacheHeader *header = (ProgramCacheHeader*) ctx->programCache;
+	if (memcmp(header->magic, PROGRAM_CACHE_MAGIC, sizeof(header->magic))
+		|| header->driver != driver
+		|| header->used < sizeof(ProgramCacheHeader)
+		|| header->used > ctx->programCacheSize) {
+		// new file, or the driver changed underneath the cached binaries
+		memcpy(header->magic, PROGRAM_CACHE_MAGIC, sizeof(header->magic));
+		header->driver = driver;
+		__atomic_store_n(&header->used, sizeof(ProgramCacheHeader), __ATOMIC_RELEASE);
+	}
+
+	flock(ctx->programCacheFd, LOCK_UN);
+	return;
+
+fail:
+	rlawtThrow(env, "unable to map program cache");
+	if (ctx->programCache) {
+		munmap(ctx->programCache, ctx->programCacheSize);
+		ctx->programCache = NULL;
+	}
+	close(ctx->programCacheFd);
+}
+
+static bool programCacheKey(JNIEnv *env, jstring jsource, uint64_t *hash, uint32_t *length) {
+	if (!jsource) {
+		rlawtThrow(env, "program source is null");
+		return false;
+	}
+
+	const char *source = (*env)->GetStringUTFChars(env, jsource, NULL);
+	if (!source) {
+		return false;
+	}
+	*length = (*env)->GetStringUTFLength(env, jsource);
+	*hash = fnv1a(0xcbf29ce484222325ull, source, *length);
+	(*env)->ReleaseStringUTFChars(env, jsource, source);
+	return true;
+}
+
+static bool programCacheOpen(JNIEnv *env, AWTContext *ctx) {
+	if (!ctx->programCache) {
+		rlawtThrow(env, "program cache is not open");
+		return false;
+	}
+	return true;
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_loadProgramBinary(JNIEnv *env, jobject self, jint program, jstring jsource) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx) || !programCacheOpen(env, ctx)) {
+		return false;
+	}
+
+	uint64_t hash;
+	uint32_t length;
+	if (!programCacheKey(env, jsource, &hash, &length)) {
+		return false;
+	}
+
+	flock(ctx->programCacheFd, LOCK_SH);
+	if (!programCacheSync(ctx)) {
+		flock(ctx->programCacheFd, LOCK_UN);
+		programCacheCloseUnmapped(ctx);
+		rlawtThrow(env, "unable to map program cache");
+		return false;
+	}
+
+	ProgramCacheHeader *header = (ProgramCacheHeader*) ctx->programCache;
+	uint64_t used = __atomic_load_n(&header->used, __ATOMIC_ACQUIRE);
+	if (header->driver != ctx->programCacheDriver || used > ctx->programCacheSize) {
+		used = 0;
+	}
+
+	// the newest entry for a key wins, since a rejected binary is stored again after relinking
+	ProgramCacheEntry *found = NULL;
+	for (uint64_t off = sizeof(ProgramCacheHeader); off + sizeof(ProgramCacheEntry) <= used; ) {
+		ProgramCacheEntry *entry = (ProgramCacheEntry*) (ctx->programCache + off);
+		uint64_t next = off + sizeof(ProgramCacheEntry) + ((entry->length + 7) & ~7u);
+		if (next > used) {
+			break;
+		}
+		if (entry->source == hash && entry->sourceLength == length) {
+			found = entry;
+		}
+		off = next;
+	}
+
+	bool linked = false;
+	if (found) {
+		glProgramBinary(program, found->format, found + 1, found->length);
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		linked = status == GL_TRUE;
+	}
+
+	flock(ctx->programCacheFd, LOCK_UN);
+	return linked;
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_storeProgramBinary(JNIEnv *env, jobject self, jint program, jstring jsource) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx) || !programCacheOpen(env, ctx)) {
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0) {
+		return;
+	}
+
+	uint64_t hash;
+	uint32_t length;
+	if (!programCacheKey(env, jsource, &hash, &length)) {
+		return;
+	}
+
+	flock(ctx->programCacheFd, LOCK_EX);
+	if (!programCacheSync(ctx)) {
+		goto fail;
+	}
+
+	ProgramCacheHeader *header = (ProgramCacheHeader*) ctx->programCache;
+	if (header->driver != ctx->programCacheDriver) {
+		// another process running on a different driver reset it, so we take it back
+		header->driver = ctx->programCacheDriver;
+		__atomic_store_n(&header->used, sizeof(ProgramCacheHeader), __ATOMIC_RELEASE);
+	}
+
+	uint64_t used = header->used;
+	uint64_t size = sizeof(ProgramCacheEntry) + ((binaryLength + 7) & ~7u);
+	if (used + size > ctx->programCacheSize) {
+		size_t newSize = ctx->programCacheSize * 2;
+		while (newSize < used + size) {
+			newSize *= 2;
+		}
+		if (ftruncate(ctx->programCacheFd, newSize) || !programCacheMap(ctx, newSize)) {
+			goto fail;
+		}
+		header = (ProgramCacheHeader*) ctx->programCache;
+	}
+
+	ProgramCacheEntry *entry = (ProgramCacheEntry*) (ctx->programCache + used);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, binaryLength, &written, &format, entry + 1);
+	if (written > 0) {
+		entry->source = hash;
+		entry->sourceLength = length;
+		entry->format = format;
+		entry->length = written;
+		entry->pad = 0;
+		__atomic_store_n(&header->used, used + sizeof(ProgramCacheEntry) + ((written + 7) & ~7u), __ATOMIC_RELEASE);
+	}
+
+	flock(ctx->programCacheFd, LOCK_UN);
+	return;
+
+fail:
+	flock(ctx->programCacheFd, LOCK_UN);
+	programCacheCloseUnmapped(ctx);
+	rlawtThrow(env, "unable to grow program cache");
+}
+
+JNIEXPORT jboolean JNICALL Java_net_runelite_rlawt_AWTContext_setShaderCompilerThreads(JNIEnv *env, jobject self, jint count) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return false;
+	}
+
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = NULL;
+	if (rlawtHasGLExtension("GL_KHR_parallel_shader_compile")) {
+		maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glXGetProcAddress((const GLubyte*) "glMaxShaderCompilerThreadsKHR");
+	} else if (rlawtHasGLExtension("GL_ARB_parallel_shader_compile")) {
+		maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glXGetProcAddress((const GLubyte*) "glMaxShaderCompilerThreadsARB");
+	}
+
+	if (!maxShaderCompilerThreads) {
+		return false;
+	}
+
+	maxShaderCompilerThreads(count < 0 ? 0xFFFFFFFFu : (GLuint) count);
+	return true;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	MEMORY_INFO_UNPROBED,
+	MEMORY_INFO_NONE,
+	MEMORY_INFO_NVX,
+	MEMORY_INFO_ATI,
+};
+
+// indices into the array returned by getRendererLimits0
+enum {
+	LIMIT_VENDOR_ID,
+	LIMIT_DEVICE_ID,
+	LIMIT_ACCELERATED,
+	LIMIT_UNIFIED_MEMORY,
+	LIMIT_VIDEO_MEMORY,
+	LIMIT_TOTAL_MEMORY,
+	LIMIT_SOFTWARE,
+	LIMIT_MAX_TEXTURE_SIZE,
+	LIMIT_MAX_3D_TEXTURE_SIZE,
+	LIMIT_MAX_ARRAY_TEXTURE_LAYERS,
+	LIMIT_MAX_RENDERBUFFER_SIZE,
+	LIMIT_MAX_SAMPLES,
+	LIMIT_MAX_COMBINED_TEXTURE_IMAGE_UNITS,
+	LIMIT_MAX_UNIFORM_BLOCK_SIZE,
+	LIMIT_MAX_VERTEX_ATTRIBS,
+	LIMIT_MAX_COLOR_ATTACHMENTS,
+	LIMIT_MAX_ANISOTROPY,
+	LIMIT_COUNT,
+};
+
+static void probeMemoryInfo(AWTContext *ctx) {
+	if (ctx->memoryInfo != MEMORY_INFO_UNPROBED) {
+		return;
+	}
+
+	if (rlawtHasGLExtension("GL_NVX_gpu_memory_info")) {
+		ctx->memoryInfo = MEMORY_INFO_NVX;
+	} else if (rlawtHasGLExtension("GL_ATI_meminfo")) {
+		ctx->memoryInfo = MEMORY_INFO_ATI;
+	} else {
+		ctx->memoryInfo = MEMORY_INFO_NONE;
+	}
+}
+
+static jlong freeVideoMemory(AWTContext *ctx) {
+	probeMemoryInfo(ctx);
+
+	GLint values[4] = {-1, -1, -1, -1};
+	switch (ctx->memoryInfo) {
+	case MEMORY_INFO_NVX:
+		glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, values);
+		return values[0];
+	case MEMORY_INFO_ATI:
+		// the first value is the total free memory in the pool
+		glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, values);
+		return values[0];
+	}
+	return -1;
+}
+
+static bool isSoftwareRenderer(const char *renderer) {
+	static const char *const names[] = {
+		"llvmpipe",
+		"softpipe",
+		"swrast",
+		"Software Rasterizer",
+	};
+	for (int i = 0; renderer && i < (int) (sizeof(names) / sizeof(names[0])); i++) {
+		if (strstr(renderer, names[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+JNIEXPORT jobjectArray JNICALL Java_net_runelite_rlawt_AWTContext_getRendererStrings0(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return NULL;
+	}
+
+	jclass stringClass = (*env)->FindClass(env, "java/lang/String");
+	if (!stringClass) {
+		return NULL;
+	}
+
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	size_t length = 1;
+	for (GLint i = 0; i < numExtensions; i++) {
+		length += strlen((const char*) glGetStringi(GL_EXTENSIONS, i)) + 1;
+	}
+	char *extensions = malloc(length);
+	if (!extensions) {
+		rlawtThrow(env, "unable to allocate extension list");
+		return NULL;
+	}
+	char *p = extensions;
+	for (GLint i = 0; i < numExtensions; i++) {
+		const char *ext = (const char*) glGetStringi(GL_EXTENSIONS, i);
+		size_t len = strlen(ext);
+		memcpy(p, ext, len);
+		p += len;
+		*p++ = ' ';
+	}
+	*(p > extensions ? p - 1 : p) = '\0';
+
+	const char *strings[] = {
+		(const char*) glGetString(GL_VENDOR),
+		(const char*) glGetString(GL_RENDERER),
+		(const char*) glGetString(GL_VERSION),
+		(const char*) glGetString(GL_SHADING_LANGUAGE_VERSION),
+		extensions,
+	};
+
+	int count = sizeof(strings) / sizeof(strings[0]);
+	jobjectArray array = (*env)->NewObjectArray(env, count, stringClass, NULL);
+	for (int i = 0; array && i < count; i++) {
+		jstring str = (*env)->NewStringUTF(env, strings[i] ? strings[i] : "");
+		if (!str) {
+			array = NULL;
+			break;
+		}
+		(*env)->SetObjectArrayElement(env, array, i, str);
+		(*env)->DeleteLocalRef(env, str);
+	}
+	free(extensions);
+	return array;
+}
+
+JNIEXPORT jlongArray JNICALL Java_net_runelite_rlawt_AWTContext_getRendererLimits0(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return NULL;
+	}
+
+	jlong limits[LIMIT_COUNT];
+	for (int i = 0; i < LIMIT_COUNT; i++) {
+		limits[i] = -1;
+	}
+
+	// only answers for glx contexts
+	PFNGLXQUERYCURRENTRENDERERINTEGERMESAPROC glXQueryCurrentRendererIntegerMESA = NULL;
+	if (!ctx->eglContext && rlawtHasExtension(glXQueryExtensionsString(ctx->dpy, DefaultScreen(ctx->dpy)), "GLX_MESA_query_renderer")) {
+		glXQueryCurrentRendererIntegerMESA = (PFNGLXQUERYCURRENTRENDERERINTEGERMESAPROC) glXGetProcAddress((const GLubyte*) "glXQueryCurrentRendererIntegerMESA");
+	}
+	if (glXQueryCurrentRendererIntegerMESA) {
+		static const struct {
+			int index;
+			int attrib;
+		} queries[] = {
+			{LIMIT_VENDOR_ID, GLX_RENDERER_VENDOR_ID_MESA},
+			{LIMIT_DEVICE_ID, GLX_RENDERER_DEVICE_ID_MESA},
+			{LIMIT_ACCELERATED, GLX_RENDERER_ACCELERATED_MESA},
+			{LIMIT_UNIFIED_MEMORY, GLX_RENDERER_UNIFIED_MEMORY_ARCHITECTURE_MESA},
+			{LIMIT_VIDEO_MEMORY, GLX_RENDERER_VIDEO_MEMORY_MESA},
+		};
+		for (int i = 0; i < (int) (sizeof(queries) / sizeof(queries[0])); i++) {
+			unsigned int value;
+			if (glXQueryCurrentRendererIntegerMESA(queries[i].attrib, &value)) {
+				limits[queries[i].index] = value;
+			}
+		}
+		if (limits[LIMIT_VIDEO_MEMORY] >= 0) {
+			// megabytes, while the gl extensions report kilobytes
+			limits[LIMIT_VIDEO_MEMORY] *= 1024;
+		}
+	}
+
+	probeMemoryInfo(ctx);
+	if (ctx->memoryInfo == MEMORY_INFO_NVX) {
+		GLint value = -1;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &value);
+		if (limits[LIMIT_VIDEO_MEMORY] < 0) {
+			limits[LIMIT_VIDEO_MEMORY] = value;
+		}
+		value = -1;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &value);
+		limits[LIMIT_TOTAL_MEMORY] = value;
+	}
+
+	const char *renderer = (const char*) glGetString(GL_RENDERER);
+	limits[LIMIT_SOFTWARE] = limits[LIMIT_ACCELERATED] == 0 || isSoftwareRenderer(renderer);
+
+	static const struct {
+		int index;
+		GLenum pname;
+	} integers[] = {
+		{LIMIT_MAX_TEXTURE_SIZE, GL_MAX_TEXTURE_SIZE},
+		{LIMIT_MAX_3D_TEXTURE_SIZE, GL_MAX_3D_TEXTURE_SIZE},
+		{LIMIT_MAX_ARRAY_TEXTURE_LAYERS, GL_MAX_ARRAY_TEXTURE_LAYERS},
+		{LIMIT_MAX_RENDERBUFFER_SIZE, GL_MAX_RENDERBUFFER_SIZE},
+		{LIMIT_MAX_SAMPLES, GL_MAX_SAMPLES},
+		{LIMIT_MAX_COMBINED_TEXTURE_IMAGE_UNITS, GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS},
+		{LIMIT_MAX_UNIFORM_BLOCK_SIZE, GL_MAX_UNIFORM_BLOCK_SIZE},
+		{LIMIT_MAX_VERTEX_ATTRIBS, GL_MAX_VERTEX_ATTRIBS},
+		{LIMIT_MAX_COLOR_ATTACHMENTS, GL_MAX_COLOR_ATTACHMENTS},
+	};
+	for (int i = 0; i < (int) (sizeof(integers) / sizeof(integers[0])); i++) {
+		GLint value = -1;
+		glGetIntegerv(integers[i].pname, &value);
+		limits[integers[i].index] = value;
+	}
+
+	if (rlawtHasGLExtension("GL_EXT_texture_filter_anisotropic") || rlawtHasGLExtension("GL_ARB_texture_filter_anisotropic")) {
+		GLfloat anisotropy = 1;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &anisotropy);
+		limits[LIMIT_MAX_ANISOTROPY] = (jlong) anisotropy;
+	}
+
+	jlongArray array = (*env)->NewLongArray(env, LIMIT_COUNT);
+	if (array) {
+		(*env)->SetLongArrayRegion(env, array, 0, LIMIT_COUNT, limits);
+	}
+	return array;
+}
+
+JNIEXPORT jlong JNICALL Java_net_runelite_rlawt_AWTContext_getFreeVideoMemory(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return -1;
+	}
+
+	return freeVideoMemory(ctx);
+}
+
+#endif
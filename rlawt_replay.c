@@ -0,0 +1,527 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// frames being read back at once while dumping, and frames waiting to be written
+#define REPLAY_READBACKS 8
+#define REPLAY_QUEUE 16
+
+typedef struct {
+	GLuint tex;
+	int width;
+	int height;
+} ReplaySlot;
+
+typedef struct {
+	uint8_t *pixels;
+	int width;
+	int height;
+} ReplayFrame;
+
+typedef struct {
+	GLuint pbo;
+	GLsync fence;
+	int width;
+	int height;
+} ReplayReadback;
+
+typedef struct {
+	int fd;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	// guarded by lock
+	ReplayFrame queue[REPLAY_QUEUE];
+	int queueHead;
+	int queueLength;
+	bool finished;
+	bool exited;
+	bool failed;
+	int written;
+
+	// render thread only, in the order they were issued
+	ReplayReadback readbacks[REPLAY_READBACKS];
+	int readbackHead;
+	int numReadbacks;
+	int nextSlot;
+	int remaining;
+	int total;
+} ReplayDump;
+
+struct ReplayBuffer {
+	ReplaySlot *slots;
+	int capacity;
+	int head;
+	int count;
+	int divisor;
+	int interval;
+	int counter;
+	GLuint fbo;
+	ReplayDump *dump;
+	bool dumpFailed;
+};
+
+// Frames are written as a stream of PAM images, flipped to be top down
+static bool writeFrame(int fd, ReplayFrame *frame) {
+	char header[128];
+	int headerLen = snprintf(header, sizeof(header),
+		"P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n",
+		frame->width, frame->height);
+
+	size_t rowBytes = (size_t) frame->width * 3;
+	uint8_t *row = malloc(rowBytes);
+	if (!row) {
+		return false;
+	}
+	for (int y = 0; y < frame->height / 2; y++) {
+		uint8_t *a = frame->pixels + y * rowBytes;
+		uint8_t *b = frame->pixels + (frame->height - 1 - y) * rowBytes;
+		memcpy(row, a, rowBytes);
+		memcpy(a, b, rowBytes);
+		memcpy(b, row, rowBytes);
+	}
+	free(row);
+
+	return rlawtWriteAll(fd, header, headerLen)
+		&& rlawtWriteAll(fd, frame->pixels, rowBytes * frame->height);
+}
+
+static void *replayWriter(void *arg) {
+	ReplayDump *d = arg;
+
+	pthread_mutex_lock(&d->lock);
+	for (;;) {
+		while (d->queueLength == 0 && !d->finished) {
+			pthread_cond_wait(&d->cond, &d->lock);
+		}
+		if (d->queueLength == 0) {
+			break;
+		}
+
+		ReplayFrame frame = d->queue[d->queueHead];
+		d->queueHead = (d->queueHead + 1) % REPLAY_QUEUE;
+		d->queueLength--;
+		bool failed = d->failed;
+		pthread_mutex_unlock(&d->lock);
+
+		if (!failed && !writeFrame(d->fd, &frame)) {
+			failed = true;
+		}
+		free(frame.pixels);
+
+		pthread_mutex_lock(&d->lock);
+		d->failed |= failed;
+		d->written++;
+	}
+	d->exited = true;
+	pthread_mutex_unlock(&d->lock);
+	return NULL;
+}
+
+static void dumpFree(AWTContext *ctx, ReplayDump *d) {
+	pthread_mutex_lock(&d->lock);
+	if (!d->finished) {
+		// abandoned part way through, so whatever is still queued is dropped
+		d->failed = true;
+		d->finished = true;
+		pthread_cond_signal(&d->cond);
+	}
+	pthread_mutex_unlock(&d->lock);
+	pthread_join(d->thread, NULL);
+
+	bool current = rlawtIsCurrent(ctx);
+	for (int i = 0; i < REPLAY_READBACKS; i++) {
+		if (current) {
+			if (d->readbacks[i].fence) {
+				glDeleteSync(d->readbacks[i].fence);
+			}
+			glDeleteBuffers(1, &d->readbacks[i].pbo);
+		}
+	}
+
+	close(d->fd);
+	pthread_cond_destroy(&d->cond);
+	pthread_mutex_destroy(&d->lock);
+	free(d);
+}
+
+// Moves finished readbacks to the writer and starts new ones, a few frames
+// per swap, so the render thread never waits on the gpu or the disk
+static void dumpStep(AWTContext *ctx) {
+	struct ReplayBuffer *r = ctx->replay;
+	ReplayDump *d = r->dump;
+	if (d->finished) {
+		return;
+	}
+
+	GLint oldPackBuffer, oldReadFbo, oldAlignment, oldRowLength, oldSkipPixels, oldSkipRows;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &oldAlignment);
+	glGetIntegerv(GL_PACK_ROW_LENGTH, &oldRowLength);
+	glGetIntegerv(GL_PACK_SKIP_PIXELS, &oldSkipPixels);
+	glGetIntegerv(GL_PACK_SKIP_ROWS, &oldSkipRows);
+
+	while (d->numReadbacks > 0) {
+		ReplayReadback *rb = &d->readbacks[d->readbackHead];
+
+		pthread_mutex_lock(&d->lock);
+		bool room = d->queueLength < REPLAY_QUEUE;
+		pthread_mutex_unlock(&d->lock);
+		if (!room) {
+			break;
+		}
+
+		GLenum status = glClientWaitSync(rb->fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(rb->fence);
+		rb->fence = NULL;
+
+		size_t size = (size_t) rb->width * rb->height * 3;
+		uint8_t *pixels = malloc(size);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		const void *src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		if (src && pixels) {
+			memcpy(pixels, src, size);
+		}
+		if (src) {
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+
+		pthread_mutex_lock(&d->lock);
+		if (src && pixels) {
+			ReplayFrame *frame = &d->queue[(d->queueHead + d->queueLength) % REPLAY_QUEUE];
+			frame->pixels = pixels;
+			frame->width = rb->width;
+			frame->height = rb->height;
+			d->queueLength++;
+			pthread_cond_signal(&d->cond);
+		} else {
+			free(pixels);
+			d->failed = true;
+		}
+		pthread_mutex_unlock(&d->lock);
+
+		d->readbackHead = (d->readbackHead + 1) % REPLAY_READBACKS;
+		d->numReadbacks--;
+	}
+
+	bool issued = false;
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, r->fbo);
+	while (d->remaining > 0 && d->numReadbacks < REPLAY_READBACKS) {
+		ReplaySlot *slot = &r->slots[d->nextSlot];
+		ReplayReadback *rb = &d->readbacks[(d->readbackHead + d->numReadbacks) % REPLAY_READBACKS];
+		if (!rb->pbo) {
+			glGenBuffers(1, &rb->pbo);
+		}
+
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot->tex, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) slot->width * slot->height * 3, NULL, GL_STREAM_READ);
+		glReadPixels(0, 0, slot->width, slot->height, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		rb->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		rb->width = slot->width;
+		rb->height = slot->height;
+
+		d->numReadbacks++;
+		d->nextSlot = (d->nextSlot + 1) % r->capacity;
+		d->remaining--;
+		issued = true;
+	}
+	if (issued) {
+		glFlush();
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, oldAlignment);
+	glPixelStorei(GL_PACK_ROW_LENGTH, oldRowLength);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, oldSkipPixels);
+	glPixelStorei(GL_PACK_SKIP_ROWS, oldSkipRows);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+
+	if (d->remaining == 0 && d->numReadbacks == 0) {
+		pthread_mutex_lock(&d->lock);
+		d->finished = true;
+		pthread_cond_signal(&d->cond);
+		pthread_mutex_unlock(&d->lock);
+	}
+}
+
+// Blits the back buffer, downscaled, into the oldest slot of the ring. Must
+// be called with the context current, before its buffers are swapped.
+// Recording is paused while the ring is being dumped.
+void rlawtReplayCapture(AWTContext *ctx) {
+	struct ReplayBuffer *r = ctx->replay;
+	if (r->dump) {
+		ReplayDump *d = r->dump;
+		dumpStep(ctx);
+
+		pthread_mutex_lock(&d->lock);
+		bool exited = d->exited;
+		bool failed = d->failed;
+		pthread_mutex_unlock(&d->lock);
+		if (!exited) {
+			return;
+		}
+
+		r->dump = NULL;
+		r->dumpFailed = failed;
+		dumpFree(ctx, d);
+	}
+
+	if (++r->counter < r->interval) {
+		return;
+	}
+	r->counter = 0;
+
+	if (ctx->width <= 0 || ctx->height <= 0) {
+		return;
+	}
+
+	int width = ctx->width / r->divisor > 0 ? ctx->width / r->divisor : 1;
+	int height = ctx->height / r->divisor > 0 ? ctx->height / r->divisor : 1;
+
+	GLint oldDrawFbo, oldReadFbo, oldTex, oldUnpackBuffer, oldReadBuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oldDrawFbo);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &oldTex);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &oldUnpackBuffer);
+	GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+
+	// a multisampled window can only be resolved at its own size
+	GLuint readFbo = 0;
+	if (ctx->multisamples > 0 && (width != ctx->width || height != ctx->height)) {
+		readFbo = rlawtResolveBackBuffer(ctx);
+	}
+
+	ReplaySlot *slot = &r->slots[r->head];
+	if (!slot->tex) {
+		glGenTextures(1, &slot->tex);
+	}
+	glBindTexture(GL_TEXTURE_2D, slot->tex);
+	if (slot->width != width || slot->height != height) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		slot->width = width;
+		slot->height = height;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, r->fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot->tex, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+	if (!readFbo) {
+		glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+		glReadBuffer(ctx->doubleBuffered ? GL_BACK : GL_FRONT);
+	}
+	glDisable(GL_SCISSOR_TEST);
+	glBlitFramebuffer(
+		0, 0, ctx->width, ctx->height,
+		0, 0, width, height,
+		GL_COLOR_BUFFER_BIT, width != ctx->width || height != ctx->height ? GL_LINEAR : GL_NEAREST);
+	if (!readFbo) {
+		glReadBuffer(oldReadBuffer);
+	}
+
+	if (scissor) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, oldUnpackBuffer);
+	glBindTexture(GL_TEXTURE_2D, oldTex);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, oldDrawFbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+
+	r->head = (r->head + 1) % r->capacity;
+	if (r->count < r->capacity) {
+		r->count++;
+	}
+}
+
+void rlawtReplayFree(AWTContext *ctx) {
+	struct ReplayBuffer *r = ctx->replay;
+	if (!r) {
+		return;
+	}
+
+	if (r->dump) {
+		dumpFree(ctx, r->dump);
+	}
+
+	if (rlawtIsCurrent(ctx)) {
+		for (int i = 0; i < r->capacity; i++) {
+			glDeleteTextures(1, &r->slots[i].tex);
+		}
+		glDeleteFramebuffers(1, &r->fbo);
+	}
+
+	free(r->slots);
+	free(r);
+	ctx->replay = NULL;
+}
+
+// The slots are attached to the framebuffer as they are drawn, so a fresh one
+// is all a replaced context needs
+void rlawtReplayRecreate(AWTContext *ctx) {
+	if (ctx->replay) {
+		glGenFramebuffers(1, &ctx->replay->fbo);
+	}
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_setReplayBuffer(JNIEnv *env, jobject self, jint frames, jint divisor, jint interval) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (ctx->replay && ctx->replay->dump) {
+		rlawtThrow(env, "replay is being dumped");
+		return;
+	}
+
+	rlawtReplayFree(ctx);
+	if (frames <= 0) {
+		return;
+	}
+
+	struct ReplayBuffer *r = calloc(1, sizeof(*r));
+	ReplaySlot *slots = calloc(frames, sizeof(*slots));
+	if (!r || !slots) {
+		free(r);
+		free(slots);
+		rlawtThrow(env, "unable to allocate replay buffer");
+		return;
+	}
+
+	r->slots = slots;
+	r->capacity = frames;
+	r->divisor = divisor > 1 ? divisor : 1;
+	r->interval = interval > 1 ? interval : 1;
+	glGenFramebuffers(1, &r->fbo);
+	ctx->replay = r;
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_dumpReplay(JNIEnv *env, jobject self, jstring jpath) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return 0;
+	}
+
+	if (!jpath) {
+		rlawtThrow(env, "replay path is null");
+		return 0;
+	}
+
+	struct ReplayBuffer *r = ctx->replay;
+	if (!r || r->count == 0) {
+		rlawtThrow(env, "replay buffer is empty");
+		return 0;
+	}
+	if (r->dump) {
+		rlawtThrow(env, "replay is already being dumped");
+		return 0;
+	}
+
+	const char *path = (*env)->GetStringUTFChars(env, jpath, NULL);
+	if (!path) {
+		return 0;
+	}
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	(*env)->ReleaseStringUTFChars(env, jpath, path);
+	if (fd < 0) {
+		rlawtThrow(env, "unable to open replay file");
+		return 0;
+	}
+
+	ReplayDump *d = calloc(1, sizeof(*d));
+	if (!d) {
+		close(fd);
+		rlawtThrow(env, "unable to allocate replay dump");
+		return 0;
+	}
+	d->fd = fd;
+	d->total = r->count;
+	d->remaining = r->count;
+	d->nextSlot = (r->head - r->count + r->capacity) % r->capacity;
+	pthread_mutex_init(&d->lock, NULL);
+	pthread_cond_init(&d->cond, NULL);
+
+	if (pthread_create(&d->thread, NULL, replayWriter, d)) {
+		pthread_cond_destroy(&d->cond);
+		pthread_mutex_destroy(&d->lock);
+		close(fd);
+		free(d);
+		rlawtThrow(env, "unable to start replay writer");
+		return 0;
+	}
+
+	r->dump = d;
+	r->dumpFailed = false;
+	return d->total;
+}
+
+JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_pollReplayDump(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true)) {
+		return 0;
+	}
+
+	struct ReplayBuffer *r = ctx->replay;
+	if (!r) {
+		return 0;
+	}
+
+	if (r->dump) {
+		ReplayDump *d = r->dump;
+		pthread_mutex_lock(&d->lock);
+		int remaining = d->total - d->written;
+		pthread_mutex_unlock(&d->lock);
+
+		// the writer may be done while the dump still waits to be cleaned up by a swap
+		return remaining > 0 ? remaining : 1;
+	}
+
+	if (r->dumpFailed) {
+		r->dumpFailed = false;
+		rlawtThrow(env, "unable to write replay");
+	}
+	return 0;
+}
+
+#endif
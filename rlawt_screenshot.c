@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define SCREENSHOT_PNG 0
+#define SCREENSHOT_QOI 1
+
+// most strips a png is split into for parallel deflate, and the fewest rows in each
+#define PNG_MAX_STRIPS 8
+#define PNG_MIN_STRIP_ROWS 64
+
+struct Screenshot {
+	int format;
+	int width;
+	int height;
+	char *path;
+	GLuint pbo;
+	GLsync fence;
+	const uint8_t *pixels;
+	pthread_t thread;
+	bool encoding;
+	bool threadStarted;
+
+	// guarded by lock once encoding
+	pthread_mutex_t lock;
+	bool done;
+	bool failed;
+	uint8_t *out;
+	size_t outLength;
+};
+
+static void put32(uint8_t *p, uint32_t v) {
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+// Rows are read back bottom up, so encoders walk them in reverse. Alpha is
+// dropped, since the window's is rarely meaningful.
+static const uint8_t *sourceRow(struct Screenshot *s, int y) {
+	return s->pixels + (size_t) (s->height - 1 - y) * s->width * 4;
+}
+
+static bool encodeQOI(struct Screenshot *s) {
+	size_t capacity = 14 + (size_t) s->width * s->height * 4 + 8;
+	uint8_t *out = malloc(capacity);
+	if (!out) {
+		return false;
+	}
+
+	memcpy(out, "qoif", 4);
+	put32(out + 4, s->width);
+	put32(out + 8, s->height);
+	out[12] = 3;
+	out[13] = 0;
+	size_t p = 14;
+
+	uint8_t index[64][3] = {{0}};
+	bool indexed[64] = {0};
+	uint8_t prev[3] = {0, 0, 0};
+	int run = 0;
+
+	for (int y = 0; y < s->height; y++) {
+		const uint8_t *row = sourceRow(s, y);
+		for (int x = 0; x < s->width; x++) {
+			const uint8_t *px = row + x * 4;
+			bool last = y == s->height - 1 && x == s->width - 1;
+
+			if (px[0] == prev[0] && px[1] == prev[1] && px[2] == prev[2]) {
+				if (++run == 62 || last) {
+					out[p++] = 0xC0 | (run - 1);
+					run = 0;
+				}
+				continue;
+			}
+
+			if (run > 0) {
+				out[p++] = 0xC0 | (run - 1);
+				run = 0;
+			}
+
+			int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+			if (indexed[hash] && !memcmp(index[hash], px, 3)) {
+				out[p++] = hash;
+			} else {
+				memcpy(index[hash], px, 3);
+				indexed[hash] = true;
+
+				int8_t dr = px[0] - prev[0];
+				int8_t dg = px[1] - prev[1];
+				int8_t db = px[2] - prev[2];
+				int8_t drg = dr - dg;
+				int8_t dbg = db - dg;
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					out[p++] = 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+				} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+					out[p++] = 0x80 | (dg + 32);
+					out[p++] = (drg + 8) << 4 | (dbg + 8);
+				} else {
+					out[p++] = 0xFE;
+					out[p++] = px[0];
+					out[p++] = px[1];
+					out[p++] = px[2];
+				}
+			}
+			memcpy(prev, px, 3);
+		}
+	}
+
+	memcpy(out + p, "\0\0\0\0\0\0\0\1", 8);
+	p += 8;
+
+	s->out = out;
+	s->outLength = p;
+	return true;
+}
+
+typedef struct {
+	struct Screenshot *shot;
+	int y0;
+	int y1;
+	bool last;
+	uint8_t *out;
+	size_t length;
+	uLong adler;
+	bool ok;
+} PNGStrip;
+
+// Filters and deflates a run of rows on its own, ending on a byte boundary
+// so the strips can simply be concatenated into one zlib stream
+static void *deflateStrip(void *arg) {
+	PNGStrip *strip = arg;
+	struct Screenshot *s = strip->shot;
+	size_t rowBytes = 1 + (size_t) s->width * 3;
+	size_t length = rowBytes * (strip->y1 - strip->y0);
+
+	uint8_t *filtered = malloc(rowBytes);
+	z_stream zs = {0};
+	if (!filtered || deflateInit2(&zs, 2, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		free(filtered);
+		return NULL;
+	}
+
+	size_t capacity = deflateBound(&zs, length) + 64;
+	strip->out = malloc(capacity);
+	if (!strip->out) {
+		goto done;
+	}
+	zs.next_out = strip->out;
+	zs.avail_out = capacity;
+	strip->adler = adler32(0, NULL, 0);
+
+	for (int y = strip->y0; y < strip->y1; y++) {
+		// sub filter, which needs nothing from the neighbouring rows
+		const uint8_t *row = sourceRow(s, y);
+		filtered[0] = 1;
+		uint8_t left[3] = {0, 0, 0};
+		for (int x = 0; x < s->width; x++) {
+			for (int c = 0; c < 3; c++) {
+				filtered[1 + x * 3 + c] = row[x * 4 + c] - left[c];
+				left[c] = row[x * 4 + c];
+			}
+		}
+		strip->adler = adler32(strip->adler, filtered, rowBytes);
+
+		zs.next_in = filtered;
+		zs.avail_in = rowBytes;
+		int flush = y + 1 < strip->y1 ? Z_NO_FLUSH : strip->last ? Z_FINISH : Z_SYNC_FLUSH;
+		int ret = deflate(&zs, flush);
+		if (ret == Z_STREAM_ERROR || zs.avail_in != 0 || (flush == Z_FINISH && ret != Z_STREAM_END)) {
+			goto done;
+		}
+	}
+
+	strip->length = capacity - zs.avail_out;
+	strip->ok = true;
+
+done:
+	deflateEnd(&zs);
+	free(filtered);
+	return NULL;
+}
+
+static void putChunk(uint8_t *out, size_t *p, const char *type, const uint8_t *data, size_t length) {
+	put32(out + *p, length);
+	memcpy(out + *p + 4, type, 4);
+	if (data && length) {
+		memcpy(out + *p + 8, data, length);
+	}
+	uLong crc = crc32(0, out + *p + 4, 4 + length);
+	put32(out + *p + 8 + length, crc);
+	*p += 12 + length;
+}
+
+static bool encodePNG(struct Screenshot *s) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int numStrips = s->height / PNG_MIN_STRIP_ROWS;
+	numStrips = numStrips < cpus ? numStrips : (int) cpus;
+	numStrips = numStrips < PNG_MAX_STRIPS ? numStrips : PNG_MAX_STRIPS;
+	numStrips = numStrips > 1 ? numStrips : 1;
+
+	PNGStrip strips[PNG_MAX_STRIPS] = {0};
+	pthread_t threads[PNG_MAX_STRIPS];
+	bool started[PNG_MAX_STRIPS] = {0};
+	for (int i = 0; i < numStrips; i++) {
+		strips[i].shot = s;
+		strips[i].y0 = (int) ((int64_t) s->height * i / numStrips);
+		strips[i].y1 = (int) ((int64_t) s->height * (i + 1) / numStrips);
+		strips[i].last = i == numStrips - 1;
+		// this thread takes the first strip itself
+		if (i > 0) {
+			started[i] = !pthread_create(&threads[i], NULL, deflateStrip, &strips[i]);
+		}
+	}
+	deflateStrip(&strips[0]);
+	for (int i = 1; i < numStrips; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		} else {
+			deflateStrip(&strips[i]);
+		}
+	}
+
+	bool ok = true;
+	size_t idatLength = 2 + 4;
+	uLong adler = adler32(0, NULL, 0);
+	size_t rowBytes = 1 + (size_t) s->width * 3;
+	for (int i = 0; i < numStrips; i++) {
+		ok &= strips[i].ok;
+		idatLength += strips[i].length;
+		adler = adler32_combine(adler, strips[i].adler, rowBytes * (strips[i].y1 - strips[i].y0));
+	}
+
+	uint8_t *out = NULL;
+	uint8_t *idat = NULL;
+	if (ok) {
+		out = malloc(8 + 25 + 12 + idatLength + 12);
+		idat = malloc(idatLength);
+	}
+	if (!out || !idat) {
+		free(out);
+		ok = false;
+		goto freeStrips;
+	}
+
+	size_t p = 0;
+	memcpy(out, "\x89PNG\r\n\x1a\n", 8);
+	p += 8;
+
+	uint8_t ihdr[13];
+	put32(ihdr, s->width);
+	put32(ihdr + 4, s->height);
+	ihdr[8] = 8; // bit depth
+	ihdr[9] = 2; // rgb
+	ihdr[10] = 0;
+	ihdr[11] = 0;
+	ihdr[12] = 0;
+	putChunk(out, &p, "IHDR", ihdr, sizeof(ihdr));
+
+	size_t q = 0;
+	idat[q++] = 0x78;
+	idat[q++] = 0x5E;
+	for (int i = 0; i < numStrips; i++) {
+		memcpy(idat + q, strips[i].out, strips[i].length);
+		q += strips[i].length;
+	}
+	put32(idat + q, adler);
+	putChunk(out, &p, "IDAT", idat, idatLength);
+	putChunk(out, &p, "IEND", NULL, 0);
+
+	s->out = out;
+	s->outLength = p;
+
+freeStrips:
+	free(idat);
+	for (int i = 0; i < numStrips; i++) {
+		free(strips[i].out);
+	}
+	return ok;
+}
+
+static void *encodeScreenshot(void *arg) {
+	struct Screenshot *s = arg;
+
+	bool ok = s->format == SCREENSHOT_QOI ? encodeQOI(s) : encodePNG(s);
+
+	if (ok && s->path) {
+		int fd = open(s->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		ok = fd >= 0 && rlawtWriteAll(fd, s->out, s->outLength);
+		if (fd >= 0) {
+			ok &= close(fd) == 0;
+		}
+		free(s->out);
+		s->out = NULL;
+		s->outLength = 0;
+	}
+
+	pthread_mutex_lock(&s->lock);
+	s->failed = !ok;
+	s->done = true;
+	pthread_mutex_unlock(&s->lock);
+	return NULL;
+}
+
+// Hands a finished readback to the encoder, or unmaps it once the encoder is
+// done. Returns true once the screenshot is complete. Must be called with the
+// context current.
+bool rlawtScreenshotStep(AWTContext *ctx) {
+	struct Screenshot *s = ctx->screenshot;
+
+	GLint oldPackBuffer;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+
+	bool done = false;
+	if (!s->encoding) {
+		GLenum status = glClientWaitSync(s->fence, 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			glDeleteSync(s->fence);
+			s->fence = NULL;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+			s->pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) s->width * s->height * 4, GL_MAP_READ_BIT);
+			s->encoding = true;
+			s->threadStarted = s->pixels && !pthread_create(&s->thread, NULL, encodeScreenshot, s);
+			if (!s->threadStarted) {
+				s->failed = true;
+				s->done = true;
+			}
+		}
+	}
+
+	if (s->encoding) {
+		pthread_mutex_lock(&s->lock);
+		done = s->done;
+		pthread_mutex_unlock(&s->lock);
+	}
+
+	if (done && s->pbo) {
+		if (s->threadStarted) {
+			pthread_join(s->thread, NULL);
+			s->threadStarted = false;
+		}
+		if (s->pixels) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			s->pixels = NULL;
+		}
+		glDeleteBuffers(1, &s->pbo);
+		s->pbo = 0;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+	return done;
+}
+
+void rlawtScreenshotFree(AWTContext *ctx) {
+	struct Screenshot *s = ctx->screenshot;
+	if (!s) {
+		return;
+	}
+	ctx->screenshot = NULL;
+
+	if (s->threadStarted) {
+		pthread_join(s->thread, NULL);
+	}
+	if (rlawtIsCurrent(ctx)) {
+		if (s->fence) {
+			glDeleteSync(s->fence);
+		}
+		if (s->pixels) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &s->pbo);
+	}
+
+	pthread_mutex_destroy(&s->lock);
+	free(s->out);
+	free(s->path);
+	free(s);
+}
+
+JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_requestScreenshot(JNIEnv *env, jobject self, jboolean front, jint format, jstring jpath) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !rlawtContextCurrent(env, ctx)) {
+		return;
+	}
+
+	if (ctx->screenshot) {
+		rlawtThrow(env, "a screenshot is already pending");
+		return;
+	}
+	if (format != SCREENSHOT_PNG && format != SCREENSHOT_QOI) {
+		rlawtThrow(env, "unknown screenshot format");
+		return;
+	}
+
+	// the size is only current after a resize has been read from the queue
+	ctx->awt.Lock(env);
+	rlawtProcessEvents(ctx);
+	rlawtUnlockAWT(env, ctx);
+	if (ctx->width <= 0 || ctx->height <= 0) {
+		rlawtThrow(env, "canvas is empty");
+		return;
+	}
+
+	struct Screenshot *s = calloc(1, sizeof(*s));
+	if (!s) {
+		rlawtThrow(env, "unable to allocate screenshot");
+		return;
+	}
+	s->format = format;
+	s->width = ctx->width;
+	s->height = ctx->height;
+
+	if (jpath) {
+		const char *path = (*env)->GetStringUTFChars(env, jpath, NULL);
+		if (!path) {
+			free(s);
+			return;
+		}
+		s->path = strdup(path);
+		(*env)->ReleaseStringUTFChars(env, jpath, path);
+		if (!s->path) {
+			free(s);
+			rlawtThrow(env, "unable to allocate screenshot");
+			return;
+		}
+	}
+	pthread_mutex_init(&s->lock, NULL);
+
+	GLint oldPackBuffer, oldReadFbo, oldReadBuffer, oldAlignment, oldRowLength, oldSkipPixels, oldSkipRows;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &oldPackBuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &oldReadFbo);
+	glGetIntegerv(GL_PACK_ALIGNMENT, &oldAlignment);
+	glGetIntegerv(GL_PACK_ROW_LENGTH, &oldRowLength);
+	glGetIntegerv(GL_PACK_SKIP_PIXELS, &oldSkipPixels);
+	glGetIntegerv(GL_PACK_SKIP_ROWS, &oldSkipRows);
+
+	glGenBuffers(1, &s->pbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+	glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) s->width * s->height * 4, NULL, GL_STREAM_READ);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
+	glReadBuffer(front || !ctx->doubleBuffered ? GL_FRONT : GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+	glReadPixels(0, 0, s->width, s->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	s->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	glReadBuffer(oldReadBuffer);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, oldAlignment);
+	glPixelStorei(GL_PACK_ROW_LENGTH, oldRowLength);
+	glPixelStorei(GL_PACK_SKIP_PIXELS, oldSkipPixels);
+	glPixelStorei(GL_PACK_SKIP_ROWS, oldSkipRows);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, oldReadFbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, oldPackBuffer);
+
+	ctx->screenshot = s;
+}
+
+JNIEXPORT jbyteArray JNICALL Java_net_runelite_rlawt_AWTContext_pollScreenshot(JNIEnv *env, jobject self) {
+	AWTContext *ctx = rlawtGetContext(env, self);
+	if (!ctx || !rlawtContextState(env, ctx, true) || !ctx->screenshot) {
+		return NULL;
+	}
+
+	if (!rlawtContextCurrent(env, ctx) || !rlawtScreenshotStep(ctx)) {
+		return NULL;
+	}
+
+	struct Screenshot *s = ctx->screenshot;
+	jbyteArray result = NULL;
+	if (s->failed) {
+		rlawtThrow(env, "unable to encode screenshot");
+	} else {
+		result = (*env)->NewByteArray(env, s->outLength);
+		if (result && s->outLength) {
+			(*env)->SetByteArrayRegion(env, result, 0, s->outLength, (const jbyte*) s->out);
+		}
+	}
+
+	rlawtScreenshotFree(ctx);
+	return result;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+
+// Storage grows in steps of this many pixels per axis, so dragging a window
+// edge only reallocates when it crosses a step
+#define TARGET_STEP 128
+// and only shrinks once the size has held still this long
+#define TARGET_SHRINK_DELAY 2000000000ll
+
+static int roundUp(int size) {
+	return (size + TARGET_STEP - 1) / TARGET_STEP * TARGET_STEP;
+}
+
+// Picks the storage size of a target which has to hold width x height,
+// returning true if its storage must be reallocated at target->width x
+// target->height. Callers draw into the bottom left corner of the storage.
+bool rlawtTargetResize(RenderTargetSize *target, int width, int height) {
+	int stepWidth = roundUp(width);
+	int stepHeight = roundUp(height);
+
+	if (width > target->width || height > target->height) {
+		target->width = stepWidth;
+		target->height = stepHeight;
+		target->shrinkAt = 0;
+		return true;
+	}
+
+	if (stepWidth == target->width && stepHeight == target->height) {
+		target->shrinkAt = 0;
+		return false;
+	}
+
+	// the storage is at least a step too big, which is only worth fixing once resizing is over
+	int64_t now = rlawtNanoTime();
+	if (!target->shrinkAt || width != target->settleWidth || height != target->settleHeight) {
+		target->settleWidth = width;
+		target->settleHeight = height;
+		target->shrinkAt = now + TARGET_SHRINK_DELAY;
+		return false;
+	}
+	if (now < target->shrinkAt) {
+		return false;
+	}
+
+	target->width = stepWidth;
+	target->height = stepHeight;
+	target->shrinkAt = 0;
+	return true;
+}
+
+#endif
@@ -45,7 +45,7 @@ void rlawtThrow(JNIEnv *env, const char *msg) {
 	}
 }
 
-static HGLRC createContext(HDC hdc) {
+static HGLRC createContext(HDC hdc, HGLRC share) {
 	HGLRC base = wglCreateContext(hdc);
 	if (!base) {
 		return NULL;
@@ -64,7 +64,7 @@ static HGLRC createContext(HDC hdc) {
 			WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
 			0
 		};
-		HGLRC gl = wglCreateContextAttribsARB(hdc, 0, attribs);
+		HGLRC gl = wglCreateContextAttribsARB(hdc, share, attribs);
 		if (!gl) {
 			wglDeleteContext(base);
 			return NULL;
@@ -79,6 +79,10 @@ static HGLRC createContext(HDC hdc) {
 		wglDeleteContext(base);
 		return gl;
 	} else {
+		if (share && !wglShareLists(share, base)) {
+			wglDeleteContext(base);
+			return NULL;
+		}
 		return base;
 	}
 }
@@ -145,7 +149,7 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_createGLContext(JNIEnv
 		goto unlock;
 	}
 
-	ctx->context = createContext(ctx->dspi->hdc);
+	ctx->context = createContext(ctx->dspi->hdc, ctx->share ? ctx->share->context : NULL);
 	if (!ctx->context) {
 		rlawtThrow(env, "unable to create context");
 		goto unlock;
@@ -181,6 +185,9 @@ void rlawtContextFreePlatform(JNIEnv *env, AWTContext *ctx) {
 	if (ctx->dsi) {
 		ctx->ds->FreeDrawingSurfaceInfo(ctx->dsi);
 	}
+	if (ctx->frameTimer) {
+		CloseHandle(ctx->frameTimer);
+	}
 }
 
 JNIEXPORT jint JNICALL Java_net_runelite_rlawt_AWTContext_setSwapInterval(JNIEnv *env, jobject self, jint interval) {
@@ -229,6 +236,8 @@ JNIEXPORT void JNICALL Java_net_runelite_rlawt_AWTContext_swapBuffers(JNIEnv *en
 		return;
 	}
 
+	rlawtFrameLimiterWait(ctx);
+
 	if (!SwapBuffers(ctx->dspi->hdc)) {
 		rlawtThrow(env, "unable to SwapBuffers");
 	}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2022 Abex
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef __unix__
+
+#include "rlawt.h"
+#include <string.h>
+
+#ifdef __x86_64__
+#	include <emmintrin.h>
+#	include <immintrin.h>
+#	define RLAWT_X86
+#endif
+
+#ifdef __ARM_NEON
+#	include <arm_neon.h>
+#endif
+
+// BT.601 limited range, with each chroma sample taken from the rounded mean
+// of its 2x2 block. Every kernel produces exactly the same output as these.
+static inline uint8_t luma(int r, int g, int b) {
+	return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static inline uint8_t chromaU(int r, int g, int b) {
+	return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+static inline uint8_t chromaV(int r, int g, int b) {
+	return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+// Converts pixels [x, width) of a pair of BGRA rows
+static void rowsScalar(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, int x, int width) {
+	for (; x < width; x += 2) {
+		const uint8_t *a = row0 + x * 4;
+		const uint8_t *b = row1 + x * 4;
+		y0[x] = luma(a[2], a[1], a[0]);
+		y0[x + 1] = luma(a[6], a[5], a[4]);
+		y1[x] = luma(b[2], b[1], b[0]);
+		y1[x + 1] = luma(b[6], b[5], b[4]);
+
+		int r = (a[2] + a[6] + b[2] + b[6] + 2) >> 2;
+		int g = (a[1] + a[5] + b[1] + b[5] + 2) >> 2;
+		int bl = (a[0] + a[4] + b[0] + b[4] + 2) >> 2;
+		u[x / 2] = chromaU(r, g, bl);
+		v[x / 2] = chromaV(r, g, bl);
+	}
+}
+
+#ifdef RLAWT_X86
+// 8 pixels of one channel, widened to 16 bits
+static inline __m128i channelSSE2(__m128i p0, __m128i p1, int shift) {
+	__m128i mask = _mm_set1_epi32(0xFF);
+	return _mm_packs_epi32(
+		_mm_and_si128(_mm_srli_epi32(p0, shift), mask),
+		_mm_and_si128(_mm_srli_epi32(p1, shift), mask));
+}
+
+// the products can exceed int16, but the sum fits in uint16, so wrapping arithmetic and a logical shift are exact
+static inline __m128i lumaSSE2(__m128i r, __m128i g, __m128i b) {
+	__m128i y = _mm_add_epi16(
+		_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+	return _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+}
+
+static inline __m128i chromaSSE2(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb) {
+	__m128i c = _mm_add_epi16(
+		_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(cb)), _mm_set1_epi16(128)));
+	return _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+}
+
+// rounded mean of each 2x2 block, from two rows of 8 pixels, in the low 4 lanes
+static inline __m128i meanSSE2(__m128i a, __m128i b) {
+	__m128i sums = _mm_madd_epi16(_mm_add_epi16(a, b), _mm_set1_epi16(1));
+	return _mm_packs_epi32(_mm_srli_epi32(_mm_add_epi32(sums, _mm_set1_epi32(2)), 2), _mm_setzero_si128());
+}
+
+static void rowsSSE2(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, int width) {
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i*) (row0 + x * 4));
+		__m128i a1 = _mm_loadu_si128((const __m128i*) (row0 + x * 4 + 16));
+		__m128i b0 = _mm_loadu_si128((const __m128i*) (row1 + x * 4));
+		__m128i b1 = _mm_loadu_si128((const __m128i*) (row1 + x * 4 + 16));
+
+		__m128i ab = channelSSE2(a0, a1, 0), ag = channelSSE2(a0, a1, 8), ar = channelSSE2(a0, a1, 16);
+		__m128i bb = channelSSE2(b0, b1, 0), bg = channelSSE2(b0, b1, 8), br = channelSSE2(b0, b1, 16);
+
+		_mm_storel_epi64((__m128i*) (y0 + x), _mm_packus_epi16(lumaSSE2(ar, ag, ab), _mm_setzero_si128()));
+		_mm_storel_epi64((__m128i*) (y1 + x), _mm_packus_epi16(lumaSSE2(br, bg, bb), _mm_setzero_si128()));
+
+		__m128i r = meanSSE2(ar, br), g = meanSSE2(ag, bg), b = meanSSE2(ab, bb);
+		int cu = _mm_cvtsi128_si32(_mm_packus_epi16(chromaSSE2(r, g, b, -38, -74, 112), _mm_setzero_si128()));
+		int cv = _mm_cvtsi128_si32(_mm_packus_epi16(chromaSSE2(r, g, b, 112, -94, -18), _mm_setzero_si128()));
+		memcpy(u + x / 2, &cu, 4);
+		memcpy(v + x / 2, &cv, 4);
+	}
+	rowsScalar(row0, row1, y0, y1, u, v, x, width);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+// packs work within each 128 bit lane, so every pack is followed by putting the quadwords back in order
+#define AVX2_ORDER(x) _mm256_permute4x64_epi64(x, 0xD8)
+
+static inline AVX2 __m256i channelAVX2(__m256i p0, __m256i p1, int shift) {
+	__m256i mask = _mm256_set1_epi32(0xFF);
+	return AVX2_ORDER(_mm256_packs_epi32(
+		_mm256_and_si256(_mm256_srli_epi32(p0, shift), mask),
+		_mm256_and_si256(_mm256_srli_epi32(p1, shift), mask)));
+}
+
+static inline AVX2 __m256i lumaAVX2(__m256i r, __m256i g, __m256i b) {
+	__m256i y = _mm256_add_epi16(
+		_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)), _mm256_mullo_epi16(g, _mm256_set1_epi16(129))),
+		_mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(25)), _mm256_set1_epi16(128)));
+	return _mm256_add_epi16(_mm256_srli_epi16(y, 8), _mm256_set1_epi16(16));
+}
+
+static inline AVX2 __m256i chromaAVX2(__m256i r, __m256i g, __m256i b, short cr, short cg, short cb) {
+	__m256i c = _mm256_add_epi16(
+		_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(cr)), _mm256_mullo_epi16(g, _mm256_set1_epi16(cg))),
+		_mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(cb)), _mm256_set1_epi16(128)));
+	return _mm256_add_epi16(_mm256_srai_epi16(c, 8), _mm256_set1_epi16(128));
+}
+
+static inline AVX2 __m256i meanAVX2(__m256i a, __m256i b) {
+	__m256i sums = _mm256_madd_epi16(_mm256_add_epi16(a, b), _mm256_set1_epi16(1));
+	return AVX2_ORDER(_mm256_packs_epi32(_mm256_srli_epi32(_mm256_add_epi32(sums, _mm256_set1_epi32(2)), 2), _mm256_setzero_si256()));
+}
+
+// the low 16 bytes of the packed result, or the low 8 when the high half of the input is empty
+static inline AVX2 __m128i packAVX2(__m256i x) {
+	return _mm256_castsi256_si128(AVX2_ORDER(_mm256_packus_epi16(x, _mm256_setzero_si256())));
+}
+
+static AVX2 void rowsAVX2(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, int width) {
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m256i a0 = _mm256_loadu_si256((const __m256i*) (row0 + x * 4));
+		__m256i a1 = _mm256_loadu_si256((const __m256i*) (row0 + x * 4 + 32));
+		__m256i b0 = _mm256_loadu_si256((const __m256i*) (row1 + x * 4));
+		__m256i b1 = _mm256_loadu_si256((const __m256i*) (row1 + x * 4 + 32));
+
+		__m256i ab = channelAVX2(a0, a1, 0), ag = channelAVX2(a0, a1, 8), ar = channelAVX2(a0, a1, 16);
+		__m256i bb = channelAVX2(b0, b1, 0), bg = channelAVX2(b0, b1, 8), br = channelAVX2(b0, b1, 16);
+
+		_mm_storeu_si128((__m128i*) (y0 + x), packAVX2(lumaAVX2(ar, ag, ab)));
+		_mm_storeu_si128((__m128i*) (y1 + x), packAVX2(lumaAVX2(br, bg, bb)));
+
+		__m256i r = meanAVX2(ar, br), g = meanAVX2(ag, bg), b = meanAVX2(ab, bb);
+		_mm_storel_epi64((__m128i*) (u + x / 2), packAVX2(chromaAVX2(r, g, b, -38, -74, 112)));
+		_mm_storel_epi64((__m128i*) (v + x / 2), packAVX2(chromaAVX2(r, g, b, 112, -94, -18)));
+	}
+	rowsSSE2(row0 + x * 4, row1 + x * 4, y0 + x, y1 + x, u + x / 2, v + x / 2, width - x);
+}
+#endif
+
+#ifdef __ARM_NEON
+static inline uint8x8_t lumaNEON(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+	uint16x8_t y = vmull_u8(r, vdup_n_u8(66));
+	y = vmlal_u8(y, g, vdup_n_u8(129));
+	y = vmlal_u8(y, b, vdup_n_u8(25));
+	return vadd_u8(vrshrn_n_u16(y, 8), vdup_n_u8(16));
+}
+
+static inline uint8x8_t chromaNEON(int16x8_t r, int16x8_t g, int16x8_t b, int16_t cr, int16_t cg, int16_t cb) {
+	int16x8_t c = vmulq_n_s16(r, cr);
+	c = vmlaq_n_s16(c, g, cg);
+	c = vmlaq_n_s16(c, b, cb);
+	c = vaddq_s16(vshrq_n_s16(vaddq_s16(c, vdupq_n_s16(128)), 8), vdupq_n_s16(128));
+	return vqmovun_s16(c);
+}
+
+// rounded mean of each 2x2 block, from two rows of 16 pixels
+static inline int16x8_t meanNEON(uint8x16_t a, uint8x16_t b) {
+	return vreinterpretq_s16_u16(vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(a), b), 2));
+}
+
+static void rowsNEON(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, int width) {
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t a = vld4q_u8(row0 + x * 4);
+		uint8x16x4_t b = vld4q_u8(row1 + x * 4);
+
+		vst1q_u8(y0 + x, vcombine_u8(
+			lumaNEON(vget_low_u8(a.val[2]), vget_low_u8(a.val[1]), vget_low_u8(a.val[0])),
+			lumaNEON(vget_high_u8(a.val[2]), vget_high_u8(a.val[1]), vget_high_u8(a.val[0]))));
+		vst1q_u8(y1 + x, vcombine_u8(
+			lumaNEON(vget_low_u8(b.val[2]), vget_low_u8(b.val[1]), vget_low_u8(b.val[0])),
+			lumaNEON(vget_high_u8(b.val[2]), vget_high_u8(b.val[1]), vget_high_u8(b.val[0]))));
+
+		int16x8_t r = meanNEON(a.val[2], b.val[2]);
+		int16x8_t g = meanNEON(a.val[1], b.val[1]);
+		int16x8_t bl = meanNEON(a.val[0], b.val[0]);
+		vst1_u8(u + x / 2, chromaNEON(r, g, bl, -38, -74, 112));
+		vst1_u8(v + x / 2, chromaNEON(r, g, bl, 112, -94, -18));
+	}
+	rowsScalar(row0, row1, y0, y1, u, v, x, width);
+}
+#endif
+
+static void rowsPortable(const uint8_t *row0, const uint8_t *row1, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, int width) {
+	rowsScalar(row0, row1, y0, y1, u, v, 0, width);
+}
+
+typedef void (*RowsKernel)(const uint8_t*, const uint8_t*, uint8_t*, uint8_t*, uint8_t*, uint8_t*, int);
+
+static RowsKernel chooseKernel(void) {
+#if defined(RLAWT_X86)
+	// sse2 is part of x86_64
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return rowsAVX2;
+	}
+	return rowsSSE2;
+#elif defined(__ARM_NEON)
+	return rowsNEON;
+#endif
+	return rowsPortable;
+}
+
+// Converts a BGRA image with even dimensions, which may be stored bottom up
+// by passing a negative stride, into I420 planes
+void rlawtBgraToI420(const uint8_t *bgra, ptrdiff_t stride, int width, int height, uint8_t *y, uint8_t *u, uint8_t *v) {
+	static RowsKernel kernel = NULL;
+	if (!kernel) {
+		kernel = chooseKernel();
+	}
+
+	for (int row = 0; row + 1 < height; row += 2) {
+		kernel(bgra + row * stride, bgra + (row + 1) * stride,
+			y + (size_t) row * width, y + (size_t) (row + 1) * width,
+			u + (size_t) row / 2 * (width / 2), v + (size_t) row / 2 * (width / 2),
+			width);
+	}
+}
+
+#endif